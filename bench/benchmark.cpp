@@ -0,0 +1,181 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using namespace std;
+
+namespace {
+
+BenchmarkStatistics ComputeStatistics(vector<chrono::nanoseconds> run_times) {
+    BenchmarkStatistics statistics;
+    if (run_times.empty()) {
+        return statistics;
+    }
+    sort(run_times.begin(), run_times.end());
+    const size_t count = run_times.size();
+    statistics.min = run_times.front();
+    statistics.max = run_times.back();
+    statistics.median = count % 2 == 1
+        ? run_times[count / 2]
+        : (run_times[count / 2 - 1] + run_times[count / 2]) / 2;
+
+    double sum = 0;
+    for (const auto run_time : run_times) {
+        sum += static_cast<double>(run_time.count());
+    }
+    const double mean = sum / count;
+    double squares_sum = 0;
+    for (const auto run_time : run_times) {
+        squares_sum += (run_time.count() - mean) * (run_time.count() - mean);
+    }
+    statistics.mean = chrono::nanoseconds(static_cast<int64_t>(mean));
+    statistics.stddev = chrono::nanoseconds(static_cast<int64_t>(sqrt(squares_sum / count)));
+    return statistics;
+}
+
+void WriteJsonString(ostream& output, string_view text) {
+    output << '"';
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            output << '\\';
+        }
+        output << c;
+    }
+    output << '"';
+}
+
+void WriteJsonObject(ostream& output, const BenchmarkParameters& parameters) {
+    output << '{';
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        output << (i > 0 ? ", "s : ""s);
+        WriteJsonString(output, parameters[i].first);
+        output << ": "s;
+        WriteJsonString(output, parameters[i].second);
+    }
+    output << '}';
+}
+
+} // namespace
+
+string BenchmarkResult::GetFullName() const {
+    string full_name = name;
+    for (const auto& [key, value] : parameters) {
+        full_name += "/"s + key + "="s + value;
+    }
+    return full_name;
+}
+
+double BenchmarkResult::GetItemsPerSecond() const {
+    if (statistics.median.count() == 0) {
+        return 0;
+    }
+    return items_per_run * 1e9 / statistics.median.count();
+}
+
+BenchmarkRunner::BenchmarkRunner(BenchmarkOptions options)
+    : options_(move(options)) {
+}
+
+void BenchmarkRunner::Run(string name, BenchmarkParameters parameters, const function<size_t()>& run) {
+    Run(move(name), move(parameters), [] {}, run);
+}
+
+void BenchmarkRunner::Run(string name, BenchmarkParameters parameters,
+                          const function<void()>& setup, const function<size_t()>& run) {
+    if (!IsSelected(name, parameters)) {
+        return;
+    }
+    BenchmarkResult result;
+    result.name = move(name);
+    result.parameters = move(parameters);
+
+    PerfCounters counters;
+    for (size_t i = 0; i < options_.warmup_runs; ++i) {
+        setup();
+        run();
+    }
+    // Счётчик может не прочитаться в отдельном повторе, поэтому среднее берётся по успешным чтениям
+    array<uint64_t, PERF_COUNTER_COUNT> counter_sums{};
+    array<size_t, PERF_COUNTER_COUNT> counter_reads{};
+    for (size_t i = 0; i < options_.repetitions; ++i) {
+        setup();
+        counters.Start();
+        result.items_per_run = run();
+        const PerfCounterValues values = counters.Stop();
+        result.run_times.push_back(values.duration);
+        for (size_t counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+            if (values.counters[counter]) {
+                counter_sums[counter] += *values.counters[counter];
+                ++counter_reads[counter];
+            }
+        }
+    }
+    result.statistics = ComputeStatistics(result.run_times);
+    result.counters.duration = result.statistics.mean;
+    for (size_t counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        if (counter_reads[counter] > 0) {
+            result.counters.counters[counter] = counter_sums[counter] / counter_reads[counter];
+        }
+    }
+    results_.push_back(move(result));
+}
+
+bool BenchmarkRunner::IsSelected(const string& name, const BenchmarkParameters& parameters) const {
+    BenchmarkResult result;
+    result.name = name;
+    result.parameters = parameters;
+    return result.GetFullName().find(options_.filter) != string::npos;
+}
+
+const vector<BenchmarkResult>& BenchmarkRunner::GetResults() const {
+    return results_;
+}
+
+void BenchmarkRunner::WriteText(ostream& output) const {
+    for (const BenchmarkResult& result : results_) {
+        const auto to_us = [](chrono::nanoseconds value) {
+            return value.count() / 1000.0;
+        };
+        output << result.GetFullName() << ": median "s << to_us(result.statistics.median)
+               << " us, min "s << to_us(result.statistics.min)
+               << " us, stddev "s << to_us(result.statistics.stddev)
+               << " us, "s << result.GetItemsPerSecond() << " items/s"s << endl;
+    }
+}
+
+void BenchmarkRunner::WriteJson(ostream& output, const BenchmarkParameters& context) const {
+    output << "{\n  \"context\": "s;
+    WriteJsonObject(output, context);
+    output << ",\n  \"benchmarks\": ["s;
+    for (size_t i = 0; i < results_.size(); ++i) {
+        const BenchmarkResult& result = results_[i];
+        output << (i > 0 ? ","s : ""s) << "\n    {\"name\": "s;
+        WriteJsonString(output, result.GetFullName());
+        output << ", \"benchmark\": "s;
+        WriteJsonString(output, result.name);
+        output << ", \"parameters\": "s;
+        WriteJsonObject(output, result.parameters);
+        output << ", \"repetitions\": "s << result.run_times.size()
+               << ", \"items_per_run\": "s << result.items_per_run
+               << ", \"min_ns\": "s << result.statistics.min.count()
+               << ", \"median_ns\": "s << result.statistics.median.count()
+               << ", \"mean_ns\": "s << result.statistics.mean.count()
+               << ", \"stddev_ns\": "s << result.statistics.stddev.count()
+               << ", \"max_ns\": "s << result.statistics.max.count()
+               << ", \"items_per_second\": "s << fixed << setprecision(1) << result.GetItemsPerSecond()
+               << defaultfloat << ", \"counters\": {"s;
+        bool is_first = true;
+        for (size_t counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+            if (result.counters.counters[counter]) {
+                output << (is_first ? ""s : ", "s);
+                WriteJsonString(output, GetPerfCounterName(static_cast<PerfCounter>(counter)));
+                output << ": "s << *result.counters.counters[counter];
+                is_first = false;
+            }
+        }
+        output << "}}"s;
+    }
+    output << "\n  ]\n}\n"s;
+}
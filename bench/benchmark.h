@@ -0,0 +1,71 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "../include/perf_counters.h"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct BenchmarkOptions {
+    size_t repetitions = 5;
+    size_t warmup_runs = 1;
+    // Запускаются только бенчмарки, полное имя которых содержит эту подстроку
+    std::string filter;
+};
+
+struct BenchmarkStatistics {
+    std::chrono::nanoseconds min{0};
+    std::chrono::nanoseconds median{0};
+    std::chrono::nanoseconds mean{0};
+    std::chrono::nanoseconds stddev{0};
+    std::chrono::nanoseconds max{0};
+};
+
+using BenchmarkParameters = std::vector<std::pair<std::string, std::string>>;
+
+struct BenchmarkResult {
+    std::string name;
+    BenchmarkParameters parameters;
+    // Число операций (документов, запросов) за один прогон
+    size_t items_per_run = 0;
+    std::vector<std::chrono::nanoseconds> run_times;
+    BenchmarkStatistics statistics;
+    // Средние значения аппаратных счётчиков за один прогон
+    PerfCounterValues counters;
+
+    // Имя вида name/parameter=value/...
+    std::string GetFullName() const;
+    double GetItemsPerSecond() const;
+};
+
+// Запускает именованные бенчмарки заданное число раз и собирает статистику по прогонам
+class BenchmarkRunner {
+public:
+    explicit BenchmarkRunner(BenchmarkOptions options);
+
+    // setup выполняется перед каждым прогоном вне замера,
+    // run возвращает число обработанных за прогон операций
+    void Run(std::string name, BenchmarkParameters parameters,
+             const std::function<void()>& setup, const std::function<size_t()>& run);
+    void Run(std::string name, BenchmarkParameters parameters, const std::function<size_t()>& run);
+
+    // Запустит ли Run бенчмарк с такими именем и параметрами: позволяет не готовить данные для пропускаемых
+    bool IsSelected(const std::string& name, const BenchmarkParameters& parameters) const;
+
+    const std::vector<BenchmarkResult>& GetResults() const;
+
+    void WriteText(std::ostream& output) const;
+    // context — описание окружения: размеры корпуса, seed, сборка
+    void WriteJson(std::ostream& output, const BenchmarkParameters& context) const;
+
+private:
+    BenchmarkOptions options_;
+    std::vector<BenchmarkResult> results_;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,1041 @@
+#include "benchmark.h"
+
+#include "../include/allocation_counter.h"
+#include "../include/concurrent_map.h"
+#include "../include/document_ingestion.h"
+#include "../include/duplicate_detector.h"
+#include "../include/levenshtein_automaton.h"
+#include "../include/load_tester.h"
+#include "../include/perfect_hash_set.h"
+#include "../include/process_queries.h"
+#include "../include/search_server.h"
+#include "../include/string_processing.h"
+#include "../include/text_generator.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+enum class CorpusKind {
+    ZIPF,
+    UNIFORM,
+};
+
+struct BenchOptions {
+    BenchmarkOptions runner;
+    CorpusKind corpus_kind = CorpusKind::ZIPF;
+    size_t document_count = 10'000;
+    size_t vocabulary_size = 50'000;
+    double zipf_exponent = 1.0;
+    size_t query_count = 1'000;
+    size_t fuzzy_term_count = 1'000'000;
+    size_t duplicate_document_count = 1'000'000;
+    unsigned seed = 5489;
+    string corpus_path;
+    string query_log_path;
+    string write_corpus_path;
+    string write_query_log_path;
+    bool json = false;
+    string output_path;
+};
+
+void PrintUsage(ostream& output) {
+    output << "Usage: search_server_bench [--json] [--output=FILE] [--filter=SUBSTRING]\n"
+              "                           [--repetitions=N] [--warmup=N] [--seed=N]\n"
+              "                           [--corpus=zipf|uniform] [--documents=N] [--vocabulary=N] [--zipf=S]\n"
+              "                           [--queries=N] [--corpus-file=FILE] [--query-file=FILE]\n"
+              "                           [--write-corpus=FILE] [--write-queries=FILE] [--fuzzy-terms=N]\n"
+              "                           [--dedup-documents=N]\n"
+              "--write-corpus and --write-queries save the generated corpus (TSV) and query log and exit\n"s;
+}
+
+BenchOptions ParseOptions(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string_view argument = argv[i];
+        const auto value_of = [argument](string_view key) -> optional<string> {
+            if (argument.substr(0, key.size()) != key) {
+                return nullopt;
+            }
+            return string(argument.substr(key.size()));
+        };
+        if (argument == "--json"sv) {
+            options.json = true;
+        } else if (const auto value = value_of("--output="sv)) {
+            options.output_path = *value;
+        } else if (const auto value = value_of("--filter="sv)) {
+            options.runner.filter = *value;
+        } else if (const auto value = value_of("--repetitions="sv)) {
+            options.runner.repetitions = stoul(*value);
+        } else if (const auto value = value_of("--warmup="sv)) {
+            options.runner.warmup_runs = stoul(*value);
+        } else if (const auto value = value_of("--corpus="sv)) {
+            if (*value == "zipf"s) {
+                options.corpus_kind = CorpusKind::ZIPF;
+            } else if (*value == "uniform"s) {
+                options.corpus_kind = CorpusKind::UNIFORM;
+            } else {
+                throw invalid_argument("Unknown corpus kind: "s + *value);
+            }
+        } else if (const auto value = value_of("--documents="sv)) {
+            options.document_count = stoul(*value);
+        } else if (const auto value = value_of("--vocabulary="sv)) {
+            options.vocabulary_size = stoul(*value);
+        } else if (const auto value = value_of("--zipf="sv)) {
+            options.zipf_exponent = stod(*value);
+        } else if (const auto value = value_of("--queries="sv)) {
+            options.query_count = stoul(*value);
+        } else if (const auto value = value_of("--fuzzy-terms="sv)) {
+            options.fuzzy_term_count = stoul(*value);
+        } else if (const auto value = value_of("--dedup-documents="sv)) {
+            options.duplicate_document_count = stoul(*value);
+        } else if (const auto value = value_of("--seed="sv)) {
+            options.seed = static_cast<unsigned>(stoul(*value));
+        } else if (const auto value = value_of("--corpus-file="sv)) {
+            options.corpus_path = *value;
+        } else if (const auto value = value_of("--query-file="sv)) {
+            options.query_log_path = *value;
+        } else if (const auto value = value_of("--write-corpus="sv)) {
+            options.write_corpus_path = *value;
+        } else if (const auto value = value_of("--write-queries="sv)) {
+            options.write_query_log_path = *value;
+        } else {
+            throw invalid_argument("Unknown argument: "s + string(argument));
+        }
+    }
+    if (options.document_count == 0 || options.query_count == 0 || options.vocabulary_size < 2) {
+        throw invalid_argument("Document and query counts must be positive, vocabulary must have at least 2 words"s);
+    }
+    return options;
+}
+
+struct Corpus {
+    string stop_words;
+    // Пуст, если корпус загружен из файла
+    vector<string> vocabulary;
+    GeneratedCorpus generated;
+    unique_ptr<MappedFile> file;
+    deque<string> decoded_texts;
+    vector<DocumentRecord> records;
+    vector<string> query_log;
+};
+
+void LoadCorpus(const string& path, Corpus& corpus) {
+    corpus.file = make_unique<MappedFile>(path);
+    string_view data = corpus.file->GetData();
+    while (!data.empty()) {
+        const size_t end = min(data.find('\n'), data.size());
+        const string_view line = data.substr(0, end);
+        data.remove_prefix(min(end + 1, data.size()));
+        if (!line.empty()) {
+            corpus.records.push_back(ParseDocumentRecord(line, DocumentFormat::AUTO, corpus.decoded_texts));
+        }
+    }
+}
+
+QueryLogOptions MakeQueryLogOptions(const BenchOptions& options) {
+    QueryLogOptions query_log_options;
+    query_log_options.query_count = options.query_count;
+    query_log_options.word_zipf_exponent = options.zipf_exponent;
+    query_log_options.seed = options.seed + 1;
+    return query_log_options;
+}
+
+Corpus PrepareCorpus(const BenchOptions& options) {
+    Corpus corpus;
+    if (!options.corpus_path.empty()) {
+        LoadCorpus(options.corpus_path, corpus);
+    } else if (options.corpus_kind == CorpusKind::ZIPF) {
+        CorpusOptions corpus_options;
+        corpus_options.document_count = options.document_count;
+        corpus_options.vocabulary_size = options.vocabulary_size;
+        corpus_options.zipf_exponent = options.zipf_exponent;
+        corpus_options.seed = options.seed;
+        corpus.generated = GenerateZipfCorpus(corpus_options);
+        corpus.vocabulary = corpus.generated.vocabulary;
+        // Самое частое слово играет роль стоп-слова
+        corpus.stop_words = corpus.vocabulary[0];
+        corpus.records = corpus.generated.GetRecords();
+    } else {
+        mt19937 generator(options.seed);
+        corpus.vocabulary = GenerateDictionary(generator, static_cast<int>(min<size_t>(options.vocabulary_size, 1000)), 10);
+        corpus.stop_words = corpus.vocabulary[0];
+        const auto texts = GenerateQueries(generator, corpus.vocabulary, static_cast<int>(options.document_count), 70);
+        for (size_t i = 0; i < texts.size(); ++i) {
+            corpus.generated.documents.push_back({static_cast<int>(i), DocumentStatus::ACTUAL, {1, 2, 3}, texts[i]});
+        }
+        corpus.generated.vocabulary = corpus.vocabulary;
+        corpus.records = corpus.generated.GetRecords();
+    }
+    if (corpus.records.empty()) {
+        throw invalid_argument("Corpus is empty"s);
+    }
+
+    if (!options.query_log_path.empty()) {
+        for (QueryLogEntry& entry : ReadQueryLog(options.query_log_path)) {
+            corpus.query_log.push_back(move(entry.query));
+        }
+    } else if (!corpus.vocabulary.empty()) {
+        corpus.query_log = GenerateQueryLog(corpus.vocabulary, MakeQueryLogOptions(options));
+    }
+    if (corpus.query_log.empty()) {
+        throw invalid_argument("Query log is empty: pass --query-file together with --corpus-file"s);
+    }
+    return corpus;
+}
+
+unique_ptr<SearchServer> BuildServer(const Corpus& corpus, const SearchServerOptions& server_options = {}) {
+    auto search_server = make_unique<SearchServer>(corpus.stop_words, server_options);
+    search_server->AddDocuments(execution::par, corpus.records);
+    return search_server;
+}
+
+string GetPolicyName(const execution::sequenced_policy&) {
+    return "seq"s;
+}
+
+string GetPolicyName(const execution::parallel_policy&) {
+    return "par"s;
+}
+
+string GetPolicyName(const AdaptivePolicy&) {
+    return "adaptive"s;
+}
+
+// Затраты, по которым adaptive_policy выбирает исполнение, и время их измерения
+BenchmarkParameters GetExecutionCosts() {
+    const auto start = chrono::steady_clock::now();
+    const ExecutionCosts& costs = ExecutionPlanner::GetCalibrated().GetCosts();
+    const auto calibration_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    return {
+        {"planner_sequential_item_ns"s, to_string(costs.sequential_item_ns)},
+        {"planner_parallel_item_ns"s, to_string(costs.parallel_item_ns)},
+        {"planner_parallel_dispatch_ns"s, to_string(costs.parallel_dispatch_ns)},
+        {"planner_max_parallelism"s, to_string(costs.max_parallelism)},
+        {"planner_calibration_us"s, to_string(calibration_us)},
+    };
+}
+
+void RunIndexingBenchmarks(BenchmarkRunner& runner, const Corpus& corpus) {
+    const string document_count = to_string(corpus.records.size());
+    unique_ptr<SearchServer> search_server;
+    const auto reset = [&search_server, &corpus] {
+        search_server = make_unique<SearchServer>(corpus.stop_words);
+    };
+    runner.Run("AddDocument"s, {{"documents"s, document_count}}, reset, [&search_server, &corpus] {
+        for (const DocumentRecord& record : corpus.records) {
+            search_server->AddDocument(record.id, record.text, record.status, record.ratings);
+        }
+        return corpus.records.size();
+    });
+    const auto add_documents = [&](const auto& policy) {
+        runner.Run("AddDocuments"s, {{"policy"s, GetPolicyName(policy)}, {"documents"s, document_count}}, reset,
+            [&search_server, &corpus, &policy] {
+                search_server->AddDocuments(policy, corpus.records);
+                return corpus.records.size();
+            });
+    };
+    add_documents(execution::seq);
+    add_documents(execution::par);
+}
+
+// Индексация со списком стоп-слов обычного размера: стоп-словами становятся самые частые слова словаря.
+// Поиск слов токенов корпуса в std::set и в совершенном хеше сравнивается отдельно.
+void RunStopWordBenchmarks(BenchmarkRunner& runner, const Corpus& corpus) {
+    const size_t stop_word_count = min<size_t>(300, corpus.vocabulary.size());
+    if (stop_word_count == 0) {
+        return;
+    }
+    const vector<string_view> stop_words(corpus.vocabulary.begin(), corpus.vocabulary.begin() + stop_word_count);
+    vector<string_view> tokens;
+    for (const DocumentRecord& record : corpus.records) {
+        const auto words = SplitIntoWords(record.text);
+        tokens.insert(tokens.end(), words.begin(), words.end());
+    }
+    const BenchmarkParameters parameters{{"stop_words"s, to_string(stop_word_count)}};
+
+    // Результат сохраняется, чтобы компилятор не выбросил поиск
+    size_t stop_token_count = 0;
+    const auto lookup = [&](const string& set_name, const auto& set, const auto& contains) {
+        BenchmarkParameters set_parameters = parameters;
+        set_parameters.insert(set_parameters.begin(), {"set"s, set_name});
+        runner.Run("StopWordLookup"s, move(set_parameters), [&tokens, &set, &contains, &stop_token_count] {
+            stop_token_count = 0;
+            for (const string_view token : tokens) {
+                stop_token_count += contains(set, token) ? 1 : 0;
+            }
+            return tokens.size();
+        });
+    };
+    const set<string, less<>> tree_set(stop_words.begin(), stop_words.end());
+    lookup("std_set"s, tree_set, [](const set<string, less<>>& set, string_view token) {
+        return set.count(token) > 0;
+    });
+    PerfectHashSet perfect_hash_set;
+    perfect_hash_set.Assign(stop_words);
+    lookup("perfect_hash"s, perfect_hash_set, [](const PerfectHashSet& set, string_view token) {
+        return set.Contains(token);
+    });
+
+    // Пропускная способность индексации в токенах в секунду
+    unique_ptr<SearchServer> search_server;
+    runner.Run("IndexTokens"s, parameters,
+        [&search_server, &stop_words] {
+            search_server = make_unique<SearchServer>(stop_words);
+        },
+        [&search_server, &corpus, &tokens] {
+            for (const DocumentRecord& record : corpus.records) {
+                search_server->AddDocument(record.id, record.text, record.status, record.ratings);
+            }
+            return tokens.size();
+        });
+}
+
+// Заменяет латинские буквы слова кириллическими: два байта на букву вместо одного
+string ToCyrillic(string_view word) {
+    static const string_view letters[] = {"а"sv, "б"sv, "в"sv, "г"sv, "д"sv, "е"sv, "ж"sv, "з"sv, "и"sv, "й"sv,
+        "к"sv, "л"sv, "м"sv, "н"sv, "о"sv, "п"sv, "р"sv, "с"sv, "т"sv, "у"sv, "ф"sv, "х"sv, "ц"sv, "ч"sv, "ш"sv, "щ"sv};
+    string result;
+    for (const char c : word) {
+        if (c >= 'a' && c <= 'z') {
+            result += letters[c - 'a'];
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+// Нормализация текста: пропускная способность NormalizeText в байтах в секунду для текста из ASCII
+// и кириллицы и индексация «грязного» варианта корпуса (заглавные буквы, знаки препинания, кавычки)
+// без нормализации и с ней. Возвращает число слов и память индекса в обоих случаях.
+BenchmarkParameters RunNormalizationBenchmarks(BenchmarkRunner& runner, const Corpus& corpus) {
+    deque<string> texts;
+    string ascii_text;
+    string cyrillic_text;
+    size_t token_count = 0;
+    mt19937 generator(17);
+    for (const DocumentRecord& record : corpus.records) {
+        string text;
+        for (const string_view word : SplitIntoWords(record.text)) {
+            ++token_count;
+            string token(word);
+            switch (generator() % 8) {
+            case 0:
+                token[0] = static_cast<char>(toupper(static_cast<unsigned char>(token[0])));
+                break;
+            case 1:
+                transform(token.begin(), token.end(), token.begin(), [](unsigned char c) {
+                    return static_cast<char>(toupper(c));
+                });
+                break;
+            case 2:
+                token += ',';
+                break;
+            case 3:
+                token = "«"s + token + "»"s;
+                break;
+            }
+            if (!text.empty()) {
+                text += ' ';
+            }
+            text += token;
+        }
+        text += '.';
+        ascii_text += text;
+        ascii_text += ' ';
+        cyrillic_text += ToCyrillic(text);
+        cyrillic_text += ' ';
+        texts.push_back(move(text));
+    }
+    vector<DocumentRecord> records = corpus.records;
+    for (size_t i = 0; i < records.size(); ++i) {
+        records[i].text = texts[i];
+    }
+
+    string output(max(ascii_text.size(), cyrillic_text.size()), '\0');
+    const auto normalize = [&](const string& text_name, const string& text) {
+        runner.Run("NormalizeText"s, {{"text"s, text_name}}, [&text, &output] {
+            NormalizeText(text, output.data());
+            return text.size();
+        });
+    };
+    normalize("ascii"s, ascii_text);
+    normalize("cyrillic"s, cyrillic_text);
+
+    BenchmarkParameters index_parameters;
+    const auto index = [&](bool normalize_text) {
+        const string value = normalize_text ? "true"s : "false"s;
+        unique_ptr<SearchServer> search_server;
+        runner.Run("IndexTokens"s, {{"normalize"s, value}},
+            [&search_server, &corpus, normalize_text] {
+                SearchServerOptions server_options;
+                server_options.normalize_text = normalize_text;
+                search_server = make_unique<SearchServer>(corpus.stop_words, server_options);
+            },
+            [&search_server, &records, token_count] {
+                for (const DocumentRecord& record : records) {
+                    search_server->AddDocument(record.id, record.text, record.status, record.ratings);
+                }
+                return token_count;
+            });
+        // Бенчмарк мог быть пропущен фильтром
+        if (search_server) {
+            index_parameters.push_back({"normalize_"s + value + "_words"s, to_string(search_server->GetWordCount())});
+            index_parameters.push_back({"normalize_"s + value + "_index_bytes"s,
+                                        to_string(search_server->GetMemoryStats().GetIndexBytes())});
+        }
+    };
+    index(false);
+    index(true);
+    return index_parameters;
+}
+
+vector<string> GenerateQueriesOfLength(const Corpus& corpus, const BenchOptions& options, int word_count) {
+    if (options.corpus_kind == CorpusKind::UNIFORM) {
+        mt19937 generator(options.seed + word_count);
+        return GenerateQueries(generator, corpus.vocabulary, static_cast<int>(options.query_count), word_count);
+    }
+    QueryLogOptions query_log_options = MakeQueryLogOptions(options);
+    query_log_options.min_query_length = word_count;
+    query_log_options.max_query_length = word_count;
+    query_log_options.seed += word_count;
+    return GenerateQueryLog(corpus.vocabulary, query_log_options);
+}
+
+void RunQueryBenchmarks(BenchmarkRunner& runner, const Corpus& corpus, const SearchServer& search_server,
+                        const BenchOptions& options) {
+    const auto find_top_documents = [&](const auto& policy, const vector<string>& queries, BenchmarkParameters parameters) {
+        parameters.insert(parameters.begin(), {"policy"s, GetPolicyName(policy)});
+        runner.Run("FindTopDocuments"s, move(parameters), [&search_server, &queries, &policy] {
+            for (const string& query : queries) {
+                search_server.FindTopDocuments(policy, query);
+            }
+            return queries.size();
+        });
+    };
+    find_top_documents(execution::seq, corpus.query_log, {{"queries"s, "log"s}});
+    find_top_documents(execution::par, corpus.query_log, {{"queries"s, "log"s}});
+    find_top_documents(adaptive_policy, corpus.query_log, {{"queries"s, "log"s}});
+    // Длину запроса можно менять, только если известен словарь корпуса
+    if (!corpus.vocabulary.empty()) {
+        for (const int word_count : {1, 2, 4, 8, 16}) {
+            const auto queries = GenerateQueriesOfLength(corpus, options, word_count);
+            find_top_documents(execution::seq, queries, {{"words"s, to_string(word_count)}});
+            find_top_documents(execution::par, queries, {{"words"s, to_string(word_count)}});
+            find_top_documents(adaptive_policy, queries, {{"words"s, to_string(word_count)}});
+        }
+    }
+
+    // Остальные политики ранжирования в сравнении с TF-IDF по умолчанию выше
+    const auto find_with_scoring = [&](auto scoring, const string& scoring_name) {
+        using Scoring = decltype(scoring);
+        const auto& queries = corpus.query_log;
+        runner.Run("FindTopDocuments"s, {{"policy"s, "seq"s}, {"queries"s, "log"s}, {"scoring"s, scoring_name}},
+            [&search_server, &queries] {
+                for (const string& query : queries) {
+                    search_server.FindTopDocuments<Scoring>(execution::seq, query);
+                }
+                return queries.size();
+            });
+    };
+    find_with_scoring(Bm25Scoring{}, "bm25"s);
+    find_with_scoring(ConstantScoring{}, "constant"s);
+
+    // Фильтр по рейтингу предикатом (проверка каждого документа списков) и через вторичный индекс
+    vector<int> ratings;
+    for (const DocumentRecord& record : corpus.records) {
+        ratings.push_back(record.ratings.empty()
+            ? 0 : accumulate(record.ratings.begin(), record.ratings.end(), 0) / static_cast<int>(record.ratings.size()));
+    }
+    sort(ratings.begin(), ratings.end());
+    for (const double selectivity : {0.01, 0.5}) {
+        if (ratings.empty()) {
+            break;
+        }
+        const RatingRange range{ratings[static_cast<size_t>((ratings.size() - 1) * (1.0 - selectivity))], ratings.back()};
+        const auto& queries = corpus.query_log;
+        const BenchmarkParameters parameters{{"selectivity"s, to_string(selectivity)}};
+        BenchmarkParameters predicate_parameters = parameters;
+        predicate_parameters.insert(predicate_parameters.begin(), {"method"s, "predicate"s});
+        runner.Run("RatingFilter"s, predicate_parameters, [&search_server, &queries, range] {
+            for (const string& query : queries) {
+                search_server.FindTopDocuments(query, [range](int, DocumentStatus status, int rating) {
+                    return status == DocumentStatus::ACTUAL && range.Contains(rating);
+                });
+            }
+            return queries.size();
+        });
+        BenchmarkParameters index_parameters = parameters;
+        index_parameters.insert(index_parameters.begin(), {"method"s, "rating_index"s});
+        runner.Run("RatingFilter"s, index_parameters, [&search_server, &queries, range] {
+            for (const string& query : queries) {
+                search_server.FindTopDocuments(query, range);
+            }
+            return queries.size();
+        });
+    }
+
+    const auto& queries = corpus.query_log;
+    runner.Run("ProcessQueries"s, {{"queries"s, to_string(queries.size())}}, [&search_server, &queries] {
+        ProcessQueries(search_server, queries);
+        return queries.size();
+    });
+
+    const auto match_document = [&](const auto& policy) {
+        runner.Run("MatchDocument"s, {{"policy"s, GetPolicyName(policy)}},
+            [&search_server, &queries, &policy, &corpus] {
+                for (size_t i = 0; i < queries.size(); ++i) {
+                    search_server.MatchDocument(policy, queries[i], corpus.records[i % corpus.records.size()].id);
+                }
+                return queries.size();
+            });
+    };
+    match_document(execution::seq);
+    match_document(execution::par);
+    match_document(adaptive_policy);
+}
+
+// Пары соседних слов из случайных документов корпуса
+vector<string> GeneratePhrases(const Corpus& corpus, const BenchOptions& options, size_t phrase_count) {
+    mt19937 generator(options.seed + 2);
+    uniform_int_distribution<size_t> document_distribution(0, corpus.records.size() - 1);
+    vector<string> phrases;
+    for (size_t attempt = 0; phrases.size() < phrase_count && attempt < phrase_count * 10; ++attempt) {
+        const vector<string_view> words = SplitIntoWords(corpus.records[document_distribution(generator)].text);
+        if (words.size() < 2) {
+            continue;
+        }
+        const size_t first = uniform_int_distribution<size_t>(0, words.size() - 2)(generator);
+        if (words[first] != corpus.stop_words && words[first + 1] != corpus.stop_words) {
+            phrases.push_back(string(words[first]) + " "s + string(words[first + 1]));
+        }
+    }
+    return phrases;
+}
+
+bool ContainsPhraseText(string_view text, string_view phrase) {
+    for (size_t pos = text.find(phrase); pos != text.npos; pos = text.find(phrase, pos + 1)) {
+        const size_t end = pos + phrase.size();
+        if ((pos == 0 || text[pos - 1] == ' ') && (end == text.size() || text[end] == ' ')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Фразовые запросы по позиционному индексу против поиска по словам с проверкой текста документов.
+// Возвращает расход памяти обоих серверов.
+BenchmarkParameters RunPhraseBenchmarks(BenchmarkRunner& runner, const Corpus& corpus, const SearchServer& search_server,
+                                        const BenchOptions& options) {
+    const auto positional_server = BuildServer(corpus, SearchServerOptions{true});
+    const vector<string> phrases = GeneratePhrases(corpus, options, min<size_t>(options.query_count, 100));
+    const PageRequest all_documents{corpus.records.size()};
+
+    runner.Run("PhraseQuery"s, {{"method"s, "positional"s}, {"queries"s, to_string(phrases.size())}},
+        [&positional_server, &phrases, &all_documents] {
+            for (const string& phrase : phrases) {
+                positional_server->FindDocumentsPage("\""s + phrase + "\""s, all_documents);
+            }
+            return phrases.size();
+        });
+
+    unordered_map<int, string_view> texts;
+    for (const DocumentRecord& record : corpus.records) {
+        texts[record.id] = record.text;
+    }
+    runner.Run("PhraseQuery"s, {{"method"s, "text_filter"s}, {"queries"s, to_string(phrases.size())}},
+        [&search_server, &phrases, &all_documents, &texts] {
+            for (const string& phrase : phrases) {
+                vector<Document> documents = search_server.FindDocumentsPage(phrase, all_documents).documents;
+                documents.erase(remove_if(documents.begin(), documents.end(), [&texts, &phrase](const Document& document) {
+                    return !ContainsPhraseText(texts.at(document.id), phrase);
+                }), documents.end());
+            }
+            return phrases.size();
+        });
+
+    return {
+        {"memory_bytes"s, to_string(search_server.GetMemoryStats().GetTotalBytes())},
+        {"positional_memory_bytes"s, to_string(positional_server->GetMemoryStats().GetTotalBytes())},
+    };
+}
+
+// Запросы из одного слова по спискам, упорядоченным по term_freq, против обхода списков целиком.
+// Возвращает расход памяти сервера со списками по term_freq.
+BenchmarkParameters RunSingleWordBenchmarks(BenchmarkRunner& runner, const Corpus& corpus, const SearchServer& search_server,
+                                            const BenchOptions& options) {
+    SearchServerOptions impact_options;
+    impact_options.impact_ordered_postings = true;
+    const auto impact_server = BuildServer(corpus, impact_options);
+    vector<string> queries;
+    if (!corpus.vocabulary.empty()) {
+        queries = GenerateQueriesOfLength(corpus, options, 1);
+    } else {
+        for (const string& query : corpus.query_log) {
+            const vector<string_view> words = SplitIntoWords(query);
+            if (!words.empty()) {
+                queries.push_back(string(words.front()));
+            }
+        }
+    }
+
+    const auto single_word = [&runner, &queries](const SearchServer& server, const string& method) {
+        runner.Run("SingleWordQuery"s, {{"method"s, method}, {"queries"s, to_string(queries.size())}}, [&server, &queries] {
+            for (const string& query : queries) {
+                server.FindTopDocuments(query);
+            }
+            return queries.size();
+        });
+    };
+    single_word(*impact_server, "impact_ordered"s);
+    single_word(search_server, "full_scan"s);
+
+    return {{"impact_memory_bytes"s, to_string(impact_server->GetMemoryStats().GetTotalBytes())}};
+}
+
+// Нечёткий поиск термов автоматом Левенштейна против вычисления расстояния до каждого терма
+void RunFuzzyBenchmarks(BenchmarkRunner& runner, const BenchOptions& options) {
+    const vector<string> methods = {"automaton"s, "brute_force"s};
+    const vector<int> distances = {1, 2};
+    // terms — запрошенное число термов, повторы среди сгенерированных удаляются
+    const auto get_parameters = [&options](const string& method, int distance) -> BenchmarkParameters {
+        return {{"method"s, method}, {"terms"s, to_string(options.fuzzy_term_count)}, {"distance"s, to_string(distance)}};
+    };
+    // Словарь строится долго: не строим его, если фильтр не выбирает ни одного бенчмарка
+    const bool is_selected = any_of(methods.begin(), methods.end(), [&](const string& method) {
+        return any_of(distances.begin(), distances.end(), [&](int distance) {
+            return runner.IsSelected("FuzzyTerms"s, get_parameters(method, distance));
+        });
+    });
+    if (!is_selected) {
+        return;
+    }
+    mt19937 generator(options.seed + 3);
+    vector<string> terms = GenerateDictionary(generator, static_cast<int>(options.fuzzy_term_count), 12);
+    sort(terms.begin(), terms.end());
+    terms.erase(unique(terms.begin(), terms.end()), terms.end());
+    TermDictionary dictionary;
+    dictionary.Assign(vector<string_view>(terms.begin(), terms.end()));
+
+    // Термы словаря с одной случайной заменой символа
+    vector<string> queries;
+    uniform_int_distribution<size_t> term_distribution(0, terms.size() - 1);
+    for (int i = 0; i < 10; ++i) {
+        string query = terms[term_distribution(generator)];
+        query[uniform_int_distribution<size_t>(0, query.size() - 1)(generator)] = uniform_int_distribution<int>('a', 'z')(generator);
+        queries.push_back(move(query));
+    }
+
+    for (const int distance : distances) {
+        runner.Run("FuzzyTerms"s, get_parameters(methods[0], distance), [&dictionary, &queries, distance] {
+            for (const string& query : queries) {
+                FindFuzzyTerms(dictionary, query, distance, numeric_limits<size_t>::max());
+            }
+            return queries.size();
+        });
+        runner.Run("FuzzyTerms"s, get_parameters(methods[1], distance), [&terms, &queries, distance] {
+            for (const string& query : queries) {
+                vector<string_view> matches;
+                for (const string& term : terms) {
+                    const size_t length_difference = term.size() > query.size() ? term.size() - query.size() : query.size() - term.size();
+                    if (length_difference <= static_cast<size_t>(distance) && ComputeEditDistance(query, term) <= distance) {
+                        matches.push_back(term);
+                    }
+                }
+            }
+            return queries.size();
+        });
+    }
+}
+
+// Корпус для поиска дубликатов: номера слов словаря без стоп-слов и повторов,
+// часть документов — подсаженные точные и почти точные копии более ранних
+struct DuplicateCorpus {
+    vector<string> vocabulary;
+    // Слова документа i — words[word_offsets[i]] .. words[word_offsets[i + 1] - 1]
+    vector<uint32_t> words;
+    vector<size_t> word_offsets = {0};
+    // Документ, с которого снята копия, или -1
+    vector<int> original_ids;
+    vector<bool> is_exact_copy;
+    size_t exact_copy_count = 0;
+    size_t near_copy_count = 0;
+
+    size_t GetDocumentCount() const {
+        return original_ids.size();
+    }
+};
+
+const double EXACT_COPY_RATE = 0.05;
+const double NEAR_COPY_RATE = 0.05;
+// Почти точная копия отличается заменой этой доли слов (хотя бы одного): сходство Жаккара около 0.9
+const size_t NEAR_COPY_CHANGED_WORDS_DIVISOR = 20;
+const double NEAR_DUPLICATE_THRESHOLD = 0.8;
+// Самые частые слова словаря играют роль стоп-слов и в документы не попадают
+const size_t DUPLICATE_CORPUS_STOP_WORD_COUNT = 100;
+
+DuplicateCorpus GenerateDuplicateCorpus(const BenchOptions& options) {
+    mt19937 generator(options.seed + 4);
+    DuplicateCorpus corpus;
+    corpus.vocabulary = GenerateDictionary(generator, static_cast<int>(options.vocabulary_size), 10);
+    sort(corpus.vocabulary.begin(), corpus.vocabulary.end());
+    corpus.vocabulary.erase(unique(corpus.vocabulary.begin(), corpus.vocabulary.end()), corpus.vocabulary.end());
+    if (corpus.vocabulary.size() <= DUPLICATE_CORPUS_STOP_WORD_COUNT * 2) {
+        throw invalid_argument("Vocabulary is too small for the duplicate corpus"s);
+    }
+
+    const ZipfDistribution word_distribution(corpus.vocabulary.size(), options.zipf_exponent);
+    uniform_int_distribution<uint32_t> content_word_distribution(DUPLICATE_CORPUS_STOP_WORD_COUNT, corpus.vocabulary.size() - 1);
+    uniform_int_distribution<int> length_distribution(20, 60);
+    uniform_real_distribution<double> kind_distribution(0.0, 1.0);
+    vector<int> originals;
+    vector<uint32_t> document_words;
+    for (size_t i = 0; i < options.duplicate_document_count; ++i) {
+        const double kind = kind_distribution(generator);
+        int original_id = -1;
+        if (!originals.empty() && kind < EXACT_COPY_RATE + NEAR_COPY_RATE) {
+            original_id = originals[uniform_int_distribution<size_t>(0, originals.size() - 1)(generator)];
+            document_words.assign(corpus.words.begin() + corpus.word_offsets[original_id],
+                                  corpus.words.begin() + corpus.word_offsets[original_id + 1]);
+        }
+        const bool is_exact_copy = original_id >= 0 && kind < EXACT_COPY_RATE;
+        if (original_id < 0) {
+            document_words.clear();
+            for (int j = length_distribution(generator); j > 0; --j) {
+                const auto word = static_cast<uint32_t>(word_distribution(generator));
+                if (word >= DUPLICATE_CORPUS_STOP_WORD_COUNT) {
+                    document_words.push_back(word);
+                }
+            }
+            sort(document_words.begin(), document_words.end());
+            document_words.erase(unique(document_words.begin(), document_words.end()), document_words.end());
+            originals.push_back(static_cast<int>(i));
+        } else if (!is_exact_copy) {
+            const size_t changed_count = max<size_t>(document_words.size() / NEAR_COPY_CHANGED_WORDS_DIVISOR, 1);
+            for (size_t j = 0; j < changed_count && j < document_words.size(); ++j) {
+                uint32_t word = content_word_distribution(generator);
+                while (find(document_words.begin(), document_words.end(), word) != document_words.end()) {
+                    word = content_word_distribution(generator);
+                }
+                document_words[uniform_int_distribution<size_t>(0, document_words.size() - 1)(generator)] = word;
+            }
+        }
+        corpus.words.insert(corpus.words.end(), document_words.begin(), document_words.end());
+        corpus.word_offsets.push_back(corpus.words.size());
+        corpus.original_ids.push_back(original_id);
+        corpus.is_exact_copy.push_back(is_exact_copy);
+        if (original_id >= 0) {
+            ++(is_exact_copy ? corpus.exact_copy_count : corpus.near_copy_count);
+        }
+    }
+    return corpus;
+}
+
+// Поиск точных дубликатов по хешу множества слов и почти точных через MinHash/LSH
+// на потоке документов, как при проверке сразу после AddDocument. Возвращает полноту:
+// долю подсаженных копий, найденных с верным оригиналом, и число остальных срабатываний.
+BenchmarkParameters RunDuplicateBenchmarks(BenchmarkRunner& runner, const BenchOptions& options) {
+    const auto get_parameters = [&options](const string& method) -> BenchmarkParameters {
+        return {{"method"s, method}, {"documents"s, to_string(options.duplicate_document_count)}};
+    };
+    const bool is_exact_selected = runner.IsSelected("DuplicateDetection"s, get_parameters("exact"s));
+    const bool is_near_selected = runner.IsSelected("DuplicateDetection"s, get_parameters("minhash_lsh"s));
+    // Корпус строится долго: не строим его, если фильтр не выбирает ни одного бенчмарка
+    if (!is_exact_selected && !is_near_selected) {
+        return {};
+    }
+    const DuplicateCorpus corpus = GenerateDuplicateCorpus(options);
+    const auto format_rate = [](size_t count, size_t total) {
+        return to_string(static_cast<double>(count) / max<size_t>(total, 1));
+    };
+    BenchmarkParameters recall = {
+        {"dedup_documents"s, to_string(corpus.GetDocumentCount())},
+        {"dedup_exact_copies"s, to_string(corpus.exact_copy_count)},
+        {"dedup_near_copies"s, to_string(corpus.near_copy_count)},
+    };
+
+    const auto detect = [&](const string& method, double similarity_threshold) {
+        size_t found_exact_copies = 0;
+        size_t found_near_copies = 0;
+        size_t false_positives = 0;
+        runner.Run("DuplicateDetection"s, get_parameters(method),
+            [&corpus, &found_exact_copies, &found_near_copies, &false_positives, similarity_threshold] {
+                found_exact_copies = found_near_copies = false_positives = 0;
+                const bool with_minhash = similarity_threshold < 1.0;
+                DuplicateDetector detector(similarity_threshold);
+                vector<pair<string_view, double>> word_freqs;
+                for (size_t i = 0; i < corpus.GetDocumentCount(); ++i) {
+                    word_freqs.clear();
+                    for (size_t j = corpus.word_offsets[i]; j < corpus.word_offsets[i + 1]; ++j) {
+                        word_freqs.emplace_back(corpus.vocabulary[corpus.words[j]], 1.0);
+                    }
+                    const int document_id = static_cast<int>(i);
+                    DuplicateMatch match;
+                    if (!detector.CheckDocument(document_id, DuplicateDetector::ComputeFingerprint(word_freqs, with_minhash), match)) {
+                        continue;
+                    }
+                    if (match.original_id != corpus.original_ids[i]) {
+                        ++false_positives;
+                    } else {
+                        ++(corpus.is_exact_copy[i] ? found_exact_copies : found_near_copies);
+                    }
+                }
+                return corpus.GetDocumentCount();
+            });
+        recall.push_back({"dedup_"s + method + "_exact_recall"s, format_rate(found_exact_copies, corpus.exact_copy_count)});
+        recall.push_back({"dedup_"s + method + "_near_recall"s, format_rate(found_near_copies, corpus.near_copy_count)});
+        recall.push_back({"dedup_"s + method + "_false_positives"s, to_string(false_positives)});
+    };
+    // Полнота выводится только для запущенных бенчмарков
+    if (is_exact_selected) {
+        detect("exact"s, 1.0);
+    }
+    if (is_near_selected) {
+        detect("minhash_lsh"s, NEAR_DUPLICATE_THRESHOLD);
+    }
+    return recall;
+}
+
+void RunRemoveBenchmarks(BenchmarkRunner& runner, const Corpus& corpus) {
+    const size_t remove_count = max<size_t>(corpus.records.size() / 10, 1);
+    unique_ptr<SearchServer> search_server;
+    const auto remove_documents = [&](const auto& policy) {
+        runner.Run("RemoveDocument"s, {{"policy"s, GetPolicyName(policy)}, {"documents"s, to_string(remove_count)}},
+            [&search_server, &corpus] {
+                search_server = BuildServer(corpus);
+            },
+            [&search_server, &corpus, &policy, remove_count] {
+                for (size_t i = 0; i < remove_count; ++i) {
+                    search_server->RemoveDocument(policy, corpus.records[i].id);
+                }
+                return remove_count;
+            });
+    };
+    remove_documents(execution::seq);
+    remove_documents(execution::par);
+    remove_documents(adaptive_policy);
+}
+
+// Резидентная память процесса по /proc/self/statm, 0 если недоступна. Свободная память кучи
+// предварительно возвращается системе, поэтому остаются живые данные и фрагментация.
+size_t GetResidentBytes() {
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    ifstream statm("/proc/self/statm"s);
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) {
+        return 0;
+    }
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Среднее число выделений памяти в куче на запрос FindTopDocuments
+BenchmarkParameters MeasureQueryAllocations(const SearchServer& search_server, const vector<string>& queries) {
+    BenchmarkParameters allocations;
+    const auto measure = [&](const auto& policy) {
+        const size_t start_count = GetAllocationCount();
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(policy, query);
+        }
+        const double per_query = static_cast<double>(GetAllocationCount() - start_count) / max<size_t>(queries.size(), 1);
+        allocations.push_back({"allocations_per_query_"s + GetPolicyName(policy), to_string(per_query)});
+    };
+    measure(execution::seq);
+    measure(execution::par);
+    return allocations;
+}
+
+// Долгая работа индекса: раунды удаления и повторного добавления десятой части документов
+// с памятью индекса из new/delete и из пула. Возвращает резидентную память сервера после
+// построения и после всех раундов.
+BenchmarkParameters RunChurnBenchmarks(BenchmarkRunner& runner, const Corpus& corpus) {
+    const size_t round_count = 20;
+    const size_t churn_count = max<size_t>(corpus.records.size() / 10, 1);
+    BenchmarkParameters resident_bytes;
+    const auto churn = [&](const string& resource_name, bool use_pool) {
+        size_t built_bytes = 0;
+        size_t churned_bytes = 0;
+        runner.Run("IndexChurn"s, {{"resource"s, resource_name}, {"rounds"s, to_string(round_count)}},
+            [&corpus, &built_bytes, &churned_bytes, use_pool, round_count, churn_count] {
+                const size_t start_bytes = GetResidentBytes();
+                optional<pmr::synchronized_pool_resource> pool;
+                SearchServerOptions server_options;
+                if (use_pool) {
+                    server_options.memory_resource = &pool.emplace();
+                }
+                const auto search_server = BuildServer(corpus, server_options);
+                built_bytes = GetResidentBytes() - min(start_bytes, GetResidentBytes());
+                int next_id = 0;
+                for (const DocumentRecord& record : corpus.records) {
+                    next_id = max(next_id, record.id + 1);
+                }
+                vector<int> ids;
+                for (const DocumentRecord& record : corpus.records) {
+                    ids.push_back(record.id);
+                }
+                for (size_t round = 0; round < round_count; ++round) {
+                    for (size_t i = 0; i < churn_count; ++i) {
+                        const size_t index = (round * churn_count + i) % ids.size();
+                        const DocumentRecord& record = corpus.records[index];
+                        search_server->RemoveDocument(ids[index]);
+                        ids[index] = next_id++;
+                        search_server->AddDocument(ids[index], record.text, record.status, record.ratings);
+                    }
+                }
+                churned_bytes = GetResidentBytes() - min(start_bytes, GetResidentBytes());
+                return round_count * churn_count;
+            });
+        resident_bytes.push_back({"churn_resident_bytes_built_"s + resource_name, to_string(built_bytes)});
+        resident_bytes.push_back({"churn_resident_bytes_after_"s + resource_name, to_string(churned_bytes)});
+    };
+    churn("new_delete"s, false);
+    churn("pool"s, true);
+    return resident_bytes;
+}
+
+void RunConcurrentMapBenchmarks(BenchmarkRunner& runner) {
+    const int key_count = 10'000;
+    const size_t operations_per_thread = 100'000;
+    for (const size_t thread_count : {1, 2, 4, 8}) {
+        for (const size_t bucket_count : {1, 12, 100}) {
+            runner.Run("ConcurrentMap"s, {{"threads"s, to_string(thread_count)}, {"buckets"s, to_string(bucket_count)}},
+                [thread_count, bucket_count, key_count, operations_per_thread] {
+                    ConcurrentMap<int, int> concurrent_map(bucket_count);
+                    vector<future<void>> futures;
+                    for (size_t thread = 0; thread < thread_count; ++thread) {
+                        futures.push_back(async(launch::async, [&concurrent_map, thread, key_count, operations_per_thread] {
+                            mt19937 generator(static_cast<unsigned>(thread));
+                            uniform_int_distribution<int> key_distribution(0, key_count - 1);
+                            for (size_t i = 0; i < operations_per_thread; ++i) {
+                                ++concurrent_map[key_distribution(generator)].ref_to_value;
+                            }
+                        }));
+                    }
+                    for (auto& f : futures) {
+                        f.get();
+                    }
+                    return thread_count * operations_per_thread;
+                });
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    try {
+        options = ParseOptions(argc, argv);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        PrintUsage(cerr);
+        return 1;
+    }
+
+    Corpus corpus;
+    try {
+        corpus = PrepareCorpus(options);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    if (!options.write_corpus_path.empty() || !options.write_query_log_path.empty()) {
+        if (!options.write_corpus_path.empty()) {
+            ofstream corpus_file(options.write_corpus_path);
+            WriteCorpus(corpus_file, corpus.generated);
+        }
+        if (!options.write_query_log_path.empty()) {
+            ofstream query_log_file(options.write_query_log_path);
+            WriteQueryLog(query_log_file, corpus.query_log);
+        }
+        return 0;
+    }
+
+    // Калибровка до построения индекса: её время не должно зависеть от состояния кучи
+    const BenchmarkParameters execution_costs = GetExecutionCosts();
+    const auto search_server = BuildServer(corpus);
+
+    BenchmarkRunner runner(options.runner);
+    RunIndexingBenchmarks(runner, corpus);
+    RunStopWordBenchmarks(runner, corpus);
+    RunQueryBenchmarks(runner, corpus, *search_server, options);
+    BenchmarkParameters memory = RunPhraseBenchmarks(runner, corpus, *search_server, options);
+    const BenchmarkParameters impact_memory = RunSingleWordBenchmarks(runner, corpus, *search_server, options);
+    memory.insert(memory.end(), impact_memory.begin(), impact_memory.end());
+    const BenchmarkParameters allocations = MeasureQueryAllocations(*search_server, corpus.query_log);
+    memory.insert(memory.end(), allocations.begin(), allocations.end());
+    const BenchmarkParameters churn_memory = RunChurnBenchmarks(runner, corpus);
+    memory.insert(memory.end(), churn_memory.begin(), churn_memory.end());
+    const BenchmarkParameters normalization_memory = RunNormalizationBenchmarks(runner, corpus);
+    memory.insert(memory.end(), normalization_memory.begin(), normalization_memory.end());
+    memory.insert(memory.end(), execution_costs.begin(), execution_costs.end());
+    RunRemoveBenchmarks(runner, corpus);
+    RunFuzzyBenchmarks(runner, options);
+    const BenchmarkParameters duplicate_recall = RunDuplicateBenchmarks(runner, options);
+    memory.insert(memory.end(), duplicate_recall.begin(), duplicate_recall.end());
+    RunConcurrentMapBenchmarks(runner);
+
+    ofstream output_file;
+    if (!options.output_path.empty()) {
+        output_file.open(options.output_path);
+        if (!output_file) {
+            cerr << "Cannot open "s << options.output_path << endl;
+            return 1;
+        }
+    }
+    ostream& output = options.output_path.empty() ? cout : output_file;
+    if (options.json) {
+        BenchmarkParameters context = {
+            {"corpus"s, !options.corpus_path.empty() ? options.corpus_path
+                        : options.corpus_kind == CorpusKind::ZIPF ? "zipf"s : "uniform"s},
+            {"documents"s, to_string(corpus.records.size())},
+            {"vocabulary"s, to_string(corpus.vocabulary.size())},
+            {"zipf_exponent"s, to_string(options.zipf_exponent)},
+            {"queries"s, !options.query_log_path.empty() ? options.query_log_path : to_string(corpus.query_log.size())},
+            {"seed"s, to_string(options.seed)},
+            {"repetitions"s, to_string(options.runner.repetitions)},
+            {"hardware_concurrency"s, to_string(thread::hardware_concurrency())},
+#ifdef NDEBUG
+            {"build"s, "release"s},
+#else
+            {"build"s, "debug"s},
+#endif
+            {"compiler"s, __VERSION__},
+        };
+        context.insert(context.end(), memory.begin(), memory.end());
+        runner.WriteJson(output, context);
+    } else {
+        runner.WriteText(output);
+        for (const auto& [name, value] : memory) {
+            output << name << ": "s << value << endl;
+        }
+    }
+    return 0;
+}
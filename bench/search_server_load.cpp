@@ -0,0 +1,113 @@
+#include "../include/document_ingestion.h"
+#include "../include/load_tester.h"
+#include "../include/search_server.h"
+
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+struct LoadOptions {
+    LoadTestOptions load_test;
+    string corpus_path;
+    string query_log_path;
+    string stop_words;
+    bool json = false;
+};
+
+void PrintUsage(ostream& output) {
+    output << "Usage: search_server_load --corpus-file=FILE --query-file=FILE [--stop-words=WORDS]\n"
+              "                          [--concurrency=N] [--qps=X] [--requests=N] [--policy=seq|par] [--json]\n"
+              "Query file: one query per line, optionally followed by <TAB>status<TAB>K.\n"
+              "K is the number of top documents requested, any positive value (default 5).\n"
+              "--qps switches to open-loop replay at the given rate; latency then counts from the scheduled send time.\n"s;
+}
+
+LoadOptions ParseOptions(int argc, char* argv[]) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string_view argument = argv[i];
+        const auto value_of = [argument](string_view key) -> optional<string> {
+            if (argument.substr(0, key.size()) != key) {
+                return nullopt;
+            }
+            return string(argument.substr(key.size()));
+        };
+        if (argument == "--json"sv) {
+            options.json = true;
+        } else if (const auto value = value_of("--corpus-file="sv)) {
+            options.corpus_path = *value;
+        } else if (const auto value = value_of("--query-file="sv)) {
+            options.query_log_path = *value;
+        } else if (const auto value = value_of("--stop-words="sv)) {
+            options.stop_words = *value;
+        } else if (const auto value = value_of("--concurrency="sv)) {
+            options.load_test.concurrency = stoul(*value);
+        } else if (const auto value = value_of("--qps="sv)) {
+            options.load_test.target_qps = stod(*value);
+        } else if (const auto value = value_of("--requests="sv)) {
+            options.load_test.request_count = stoul(*value);
+        } else if (const auto value = value_of("--policy="sv)) {
+            if (*value != "seq"s && *value != "par"s) {
+                throw invalid_argument("Unknown policy: "s + *value);
+            }
+            options.load_test.use_parallel_policy = *value == "par"s;
+        } else {
+            throw invalid_argument("Unknown argument: "s + string(argument));
+        }
+    }
+    if (options.corpus_path.empty() || options.query_log_path.empty()) {
+        throw invalid_argument("--corpus-file and --query-file are required"s);
+    }
+    return options;
+}
+
+void WriteReport(ostream& output, const LoadTestReport& report, const LoadOptions& options) {
+    const auto to_us = [](chrono::nanoseconds value) {
+        return value.count() / 1000.0;
+    };
+    if (options.json) {
+        output << "{\"requests\": "s << report.request_count
+               << ", \"errors\": "s << report.error_count
+               << ", \"concurrency\": "s << options.load_test.concurrency
+               << ", \"target_qps\": "s << options.load_test.target_qps
+               << ", \"seconds\": "s << report.seconds
+               << ", \"throughput_qps\": "s << report.GetThroughput()
+               << ", \"latency_us\": {\"mean\": "s << to_us(report.latency.mean)
+               << ", \"p50\": "s << to_us(report.latency.p50)
+               << ", \"p99\": "s << to_us(report.latency.p99)
+               << ", \"p999\": "s << to_us(report.latency.p999)
+               << ", \"max\": "s << to_us(report.latency.max) << "}}"s << endl;
+        return;
+    }
+    output << report.request_count << " requests ("s << report.error_count << " errors) in "s
+           << report.seconds << " s: "s << report.GetThroughput() << " qps"s << endl
+           << "latency: mean "s << to_us(report.latency.mean) << " us, p50 "s << to_us(report.latency.p50)
+           << " us, p99 "s << to_us(report.latency.p99) << " us, p999 "s << to_us(report.latency.p999)
+           << " us, max "s << to_us(report.latency.max) << " us"s << endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const LoadOptions options = ParseOptions(argc, argv);
+        SearchServer search_server(options.stop_words);
+        const IngestionStats ingestion = IngestDocuments(search_server, options.corpus_path);
+        const vector<QueryLogEntry> query_log = ReadQueryLog(options.query_log_path);
+        cerr << "Indexed "s << ingestion.document_count << " documents, replaying "s
+             << query_log.size() << " queries"s << endl;
+        WriteReport(cout, RunLoadTest(search_server, query_log, options.load_test), options);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        PrintUsage(cerr);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+// Число вызовов глобального operator new в программе с момента запуска.
+// Счётчик работает в программах, которые вызывают GetAllocationCount: вместе с ним
+// компонуется замена operator new из allocation_counter.cpp. Используется тестами
+// и бенчмарками, чтобы считать выделения памяти в куче на запрос.
+size_t GetAllocationCount();
+
+#endif // ALLOCATION_COUNTER_H
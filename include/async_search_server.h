@@ -0,0 +1,97 @@
+#ifndef ASYNC_SEARCH_SERVER_H
+#define ASYNC_SEARCH_SERVER_H
+
+#include "bounded_queue.h"
+#include "document.h"
+#include "search_server.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AsyncSearchResult {
+    std::vector<Document> documents;
+    // Время ожидания в очереди и время выполнения поиска измеряются раздельно
+    std::chrono::nanoseconds queue_time{0};
+    std::chrono::nanoseconds execution_time{0};
+};
+
+// Асинхронный интерфейс поиска: запросы выполняются фиксированным числом рабочих потоков,
+// ожидающие запросы хранятся в очереди ограниченной длины.
+// FindTopDocumentsAsync блокирует вызывающий поток, пока очередь заполнена,
+// TryFindTopDocumentsAsync в этом случае сразу возвращает std::nullopt.
+class AsyncSearchServer {
+public:
+    static const size_t DEFAULT_QUEUE_CAPACITY = 1024;
+
+    explicit AsyncSearchServer(const SearchServer& search_server,
+                               size_t worker_count = std::thread::hardware_concurrency(),
+                               size_t queue_capacity = DEFAULT_QUEUE_CAPACITY);
+    // Дожидается выполнения всех принятых запросов
+    ~AsyncSearchServer();
+
+    AsyncSearchServer(const AsyncSearchServer&) = delete;
+    AsyncSearchServer& operator=(const AsyncSearchServer&) = delete;
+
+    template <typename DocumentPredicate>
+    std::future<AsyncSearchResult> FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate);
+    std::future<AsyncSearchResult> FindTopDocumentsAsync(std::string raw_query, DocumentStatus status);
+    std::future<AsyncSearchResult> FindTopDocumentsAsync(std::string raw_query);
+
+    template <typename DocumentPredicate>
+    std::optional<std::future<AsyncSearchResult>> TryFindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate);
+    std::optional<std::future<AsyncSearchResult>> TryFindTopDocumentsAsync(std::string raw_query, DocumentStatus status);
+    std::optional<std::future<AsyncSearchResult>> TryFindTopDocumentsAsync(std::string raw_query);
+
+    size_t GetQueueSize() const;
+    size_t GetWorkerCount() const;
+    // Количество запросов, отклонённых TryFindTopDocumentsAsync из-за заполненной очереди
+    size_t GetRejectedCount() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Task {
+        std::function<std::vector<Document>()> search;
+        std::promise<AsyncSearchResult> promise;
+        Clock::time_point enqueue_time;
+    };
+
+    const SearchServer& search_server_;
+    BoundedQueue<Task> tasks_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> rejected_count_{0};
+
+    template <typename DocumentPredicate>
+    Task MakeTask(std::string raw_query, DocumentPredicate document_predicate) const;
+    std::future<AsyncSearchResult> Submit(Task task);
+    std::optional<std::future<AsyncSearchResult>> TrySubmit(Task task);
+    void RunWorker();
+};
+
+template <typename DocumentPredicate>
+AsyncSearchServer::Task AsyncSearchServer::MakeTask(std::string raw_query, DocumentPredicate document_predicate) const {
+    Task task;
+    task.search = [this, raw_query = std::move(raw_query), document_predicate]() {
+        return search_server_.FindTopDocuments(raw_query, document_predicate);
+    };
+    task.enqueue_time = Clock::now();
+    return task;
+}
+
+template <typename DocumentPredicate>
+std::future<AsyncSearchResult> AsyncSearchServer::FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate) {
+    return Submit(MakeTask(std::move(raw_query), document_predicate));
+}
+
+template <typename DocumentPredicate>
+std::optional<std::future<AsyncSearchResult>> AsyncSearchServer::TryFindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate) {
+    return TrySubmit(MakeTask(std::move(raw_query), document_predicate));
+}
+
+#endif // ASYNC_SEARCH_SERVER_H
@@ -5,6 +5,8 @@
 #include <cstdlib>
 #include <future>
 #include <map>
+#include <memory_resource>
+#include <mutex>
 #include <numeric>
 #include <random>
 #include <string>
@@ -17,9 +19,12 @@
 template <typename Key, typename Value>
 class ConcurrentMap {
 private:
+    // Узлы корзины берутся из её пула под мьютексом корзины, поэтому пул несинхронизированный.
+    // После Clear память узлов остаётся в пуле и переиспользуется.
     struct Bucket {
         std::mutex mutex;
-        std::map<Key, Value> map;
+        std::pmr::unsynchronized_pool_resource pool;
+        std::pmr::map<Key, Value> map{&pool};
     };
 
 public:
@@ -44,12 +49,31 @@ public:
         return {key, bucket};
     }
 
+    void Erase(const Key& key) {
+        auto& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
+        std::lock_guard g(bucket.mutex);
+        bucket.map.erase(key);
+    }
+
+    void Clear() {
+        for (auto& bucket : buckets_) {
+            std::lock_guard g(bucket.mutex);
+            bucket.map.clear();
+        }
+    }
+
+    // Добавляет содержимое всех корзин в result
+    template <typename Map>
+    void MergeInto(Map& result) {
+        for (auto& bucket : buckets_) {
+            std::lock_guard g(bucket.mutex);
+            result.insert(bucket.map.begin(), bucket.map.end());
+        }
+    }
+
     std::map<Key, Value> BuildOrdinaryMap() {
         std::map<Key, Value> result;
-        for (auto& [mutex, map] : buckets_) {
-            std::lock_guard g(mutex);
-            result.insert(map.begin(), map.end());
-        }
+        MergeInto(result);
         return result;
     }
 
@@ -0,0 +1,92 @@
+#ifndef CONCURRENT_REQUEST_QUEUE_H
+#define CONCURRENT_REQUEST_QUEUE_H
+
+#include "search_server.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Статистика запросов к поисковому серверу из многих потоков за скользящее окно реального времени.
+// Запросы записываются в кольцевой буфер фиксированного размера без блокировок:
+// запись занимает слот атомарным счётчиком и публикует его через номер версии (seqlock),
+// чтение пропускает слоты, которые в этот момент перезаписываются.
+// Если за окно поступило больше запросов, чем ёмкость буфера, статистика
+// учитывает только последние capacity запросов.
+class ConcurrentRequestQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static const size_t DEFAULT_CAPACITY = 1 << 16;
+
+    struct Statistics {
+        size_t request_count = 0;
+        size_t no_result_count = 0;
+        // Количество запросов по числу найденных документов
+        std::array<size_t, MAX_RESULT_DOCUMENT_COUNT + 1> result_size_counts{};
+        Clock::duration latency_p50{0};
+        Clock::duration latency_p90{0};
+        Clock::duration latency_p99{0};
+        Clock::duration latency_max{0};
+    };
+
+    // Ёмкость округляется вверх до степени двойки
+    explicit ConcurrentRequestQueue(const SearchServer& search_server,
+                                    Clock::duration window = std::chrono::hours(24),
+                                    size_t capacity = DEFAULT_CAPACITY);
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate);
+    template <typename ExecutionPolicy>
+    std::vector<Document> AddFindRequest(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status);
+    template <typename ExecutionPolicy>
+    std::vector<Document> AddFindRequest(const ExecutionPolicy& policy, std::string_view raw_query);
+    std::vector<Document> AddFindRequest(std::string_view raw_query);
+
+    void RecordRequest(size_t result_count, Clock::duration latency, Clock::time_point finish_time = Clock::now());
+
+    Statistics GetStatistics(Clock::time_point now = Clock::now()) const;
+    int GetNoResultRequests() const;
+
+private:
+    struct Slot {
+        // Нечётное значение — слот перезаписывается
+        std::atomic<uint64_t> version{0};
+        std::atomic<int64_t> finish_time{0};
+        std::atomic<int64_t> latency{0};
+        std::atomic<uint32_t> result_count{0};
+    };
+
+    const SearchServer& search_server_;
+    const Clock::duration window_;
+    const size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> next_index_{0};
+};
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> ConcurrentRequestQueue::AddFindRequest(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate) {
+    const auto start_time = Clock::now();
+    auto result = search_server_.FindTopDocuments(policy, raw_query, document_predicate);
+    const auto finish_time = Clock::now();
+    RecordRequest(result.size(), finish_time - start_time, finish_time);
+    return result;
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ConcurrentRequestQueue::AddFindRequest(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) {
+    return AddFindRequest(policy, raw_query, [status](int, DocumentStatus document_status, int) {
+        return document_status == status;
+    });
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ConcurrentRequestQueue::AddFindRequest(const ExecutionPolicy& policy, std::string_view raw_query) {
+    return AddFindRequest(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+#endif // CONCURRENT_REQUEST_QUEUE_H
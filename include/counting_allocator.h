@@ -0,0 +1,98 @@
+#ifndef COUNTING_ALLOCATOR_H
+#define COUNTING_ALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+
+// Количество байт, выделенных через связанные с ним CountingAllocator.
+// Изменяется атомарно: контейнеры могут освобождать память из параллельных алгоритмов.
+class MemoryCounter {
+public:
+    void Allocate(size_t bytes) noexcept {
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void Deallocate(size_t bytes) noexcept {
+        bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    size_t GetBytes() const noexcept {
+        return bytes_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<size_t> bytes_{0};
+};
+
+// Аллокатор, учитывающий выделенную память в MemoryCounter. Память берётся из memory_resource,
+// если он задан, иначе из std::allocator. Аллокатор без счётчика (по умолчанию) ничего не учитывает.
+template <typename T>
+class CountingAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    CountingAllocator() noexcept = default;
+
+    explicit CountingAllocator(MemoryCounter* counter, std::pmr::memory_resource* resource = nullptr) noexcept
+        : counter_(counter)
+        , resource_(resource) {
+    }
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) noexcept
+        : counter_(other.GetCounter())
+        , resource_(other.GetResource()) {
+    }
+
+    T* allocate(size_t n) {
+        T* result = resource_ != nullptr
+            ? static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)))
+            : std::allocator<T>().allocate(n);
+        if (counter_ != nullptr) {
+            counter_->Allocate(n * sizeof(T));
+        }
+        return result;
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (counter_ != nullptr) {
+            counter_->Deallocate(n * sizeof(T));
+        }
+        if (resource_ != nullptr) {
+            resource_->deallocate(p, n * sizeof(T), alignof(T));
+        } else {
+            std::allocator<T>().deallocate(p, n);
+        }
+    }
+
+    MemoryCounter* GetCounter() const noexcept {
+        return counter_;
+    }
+
+    std::pmr::memory_resource* GetResource() const noexcept {
+        return resource_;
+    }
+
+private:
+    MemoryCounter* counter_ = nullptr;
+    std::pmr::memory_resource* resource_ = nullptr;
+};
+
+template <typename T, typename U>
+bool operator==(const CountingAllocator<T>& lhs, const CountingAllocator<U>& rhs) noexcept {
+    return lhs.GetCounter() == rhs.GetCounter() && lhs.GetResource() == rhs.GetResource();
+}
+
+template <typename T, typename U>
+bool operator!=(const CountingAllocator<T>& lhs, const CountingAllocator<U>& rhs) noexcept {
+    return !(lhs == rhs);
+}
+
+#endif // COUNTING_ALLOCATOR_H
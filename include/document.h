@@ -1,6 +1,8 @@
 #ifndef DOCUMENT_H
 #define DOCUMENT_H
 #include <iostream>
+#include <string_view>
+#include <vector>
 
 struct Document {
     Document() = default;
@@ -23,6 +25,18 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+// Входные данные документа для пакетного добавления (SearchServer::AddDocuments).
+// Текст не копируется до момента вставки в индекс.
+struct DocumentRecord {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string_view text;
+};
+
 std::ostream& operator<<(std::ostream& out, const Document& document);
 
+// Выводит имя статуса: ACTUAL, IRRELEVANT, BANNED, REMOVED
+std::ostream& operator<<(std::ostream& out, DocumentStatus status);
+
 #endif // DOCUMENT_H
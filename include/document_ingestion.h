@@ -0,0 +1,70 @@
+#ifndef DOCUMENT_INGESTION_H
+#define DOCUMENT_INGESTION_H
+
+#include "document.h"
+#include "search_server.h"
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Файл, отображённый в память только для чтения.
+// Если отображение недоступно, файл читается в память целиком.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view GetData() const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool is_mapped_ = false;
+    std::string buffer_;
+};
+
+enum class DocumentFormat {
+    AUTO,
+    // id<TAB>status<TAB>ratings через пробел<TAB>text
+    TSV,
+    // {"id": 1, "status": "ACTUAL", "ratings": [1, 2], "text": "..."}
+    JSONL,
+};
+
+// Принимает имя статуса (ACTUAL, ...) или его номер.
+// При неизвестном статусе выбрасывает std::invalid_argument.
+DocumentStatus ParseDocumentStatus(std::string_view text);
+
+// Разбирает одну строку корпуса. Текст документа ссылается на line; если в JSON-строке
+// есть escape-последовательности, раскодированный текст сохраняется в decoded_texts.
+// При ошибке формата выбрасывает std::invalid_argument.
+DocumentRecord ParseDocumentRecord(std::string_view line, DocumentFormat format, std::deque<std::string>& decoded_texts);
+
+struct IngestionOptions {
+    DocumentFormat format = DocumentFormat::AUTO;
+    // Количество документов, передаваемых между стадиями за раз
+    size_t batch_size = 1024;
+    // Количество пакетов, ожидающих в очереди между стадиями
+    size_t queue_capacity = 4;
+};
+
+struct IngestionStats {
+    size_t document_count = 0;
+    size_t byte_count = 0;
+    double seconds = 0.0;
+
+    double GetMegabytesPerSecond() const;
+};
+
+// Загружает корпус из файла конвейером из трёх стадий в отдельных потоках:
+// разбор записей -> разбиение на слова -> вставка в индекс.
+// Стадии связаны очередями ограниченной ёмкости, поэтому память не растёт,
+// если индексирование отстаёт от чтения.
+IngestionStats IngestDocuments(SearchServer& search_server, const std::string& path, const IngestionOptions& options = {});
+
+#endif // DOCUMENT_INGESTION_H
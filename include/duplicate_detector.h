@@ -0,0 +1,114 @@
+#ifndef DUPLICATE_DETECTOR_H
+#define DUPLICATE_DETECTOR_H
+
+#include "search_server.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <execution>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Отпечаток множества слов документа.
+// word_set_hash — 128-битный хеш, не зависящий от порядка слов: совпадает у документов
+// с одинаковым набором слов. minhash — сигнатура MinHash для оценки сходства Жаккара.
+struct DocumentFingerprint {
+    static const size_t MINHASH_SIZE = 64;
+
+    std::pair<uint64_t, uint64_t> word_set_hash{0, 0};
+    std::array<uint32_t, MINHASH_SIZE> minhash{};
+};
+
+struct DuplicateMatch {
+    int document_id = 0;
+    // Ранее добавленный документ, дубликатом которого является document_id
+    int original_id = 0;
+    // Оценка сходства Жаккара по сигнатуре MinHash, 1.0 для точных дубликатов
+    double similarity = 0.0;
+    bool is_exact = false;
+};
+
+// Поиск точных и почти точных дубликатов.
+// Точные дубликаты находятся по хешу множества слов, почти точные — через LSH:
+// сигнатура MinHash делится на полосы, документы с совпадающей полосой становятся
+// кандидатами и проверяются по оценке сходства.
+class DuplicateDetector {
+public:
+    static const size_t BAND_COUNT = 16;
+    static const size_t ROWS_PER_BAND = DocumentFingerprint::MINHASH_SIZE / BAND_COUNT;
+
+    // При similarity_threshold >= 1 ищутся только точные дубликаты.
+    // Порог не больше 0 выбрасывает std::invalid_argument: дубликатом оказался бы любой кандидат LSH.
+    explicit DuplicateDetector(double similarity_threshold = 1.0);
+
+    // Сигнатура MinHash нужна только для поиска почти точных дубликатов
+    template <typename WordFrequencies>
+    static DocumentFingerprint ComputeFingerprint(const WordFrequencies& word_freqs, bool with_minhash = true);
+
+    // Проверяет документ на дублирование с ранее добавленными и запоминает его.
+    // Возвращает true и заполняет match, если найден дубликат; дубликат не запоминается.
+    bool CheckDocument(int document_id, const DocumentFingerprint& fingerprint, DuplicateMatch& match);
+    void RemoveDocument(int document_id);
+
+    // Находит дубликаты среди всех документов сервера; оригиналом считается документ с меньшим id.
+    // Отпечатки вычисляются согласно политике исполнения.
+    template <typename ExecutionPolicy>
+    std::vector<DuplicateMatch> FindDuplicates(const ExecutionPolicy& policy, const SearchServer& search_server);
+
+    size_t GetDocumentCount() const;
+
+private:
+    using WordSetHash = std::pair<uint64_t, uint64_t>;
+
+    struct WordSetHasher {
+        size_t operator()(const WordSetHash& hash) const {
+            return static_cast<size_t>(hash.first ^ (hash.second * 0x9E3779B97F4A7C15ull));
+        }
+    };
+
+    const double similarity_threshold_;
+    std::unordered_map<WordSetHash, int, WordSetHasher> exact_index_;
+    std::array<std::unordered_map<uint64_t, std::vector<int>>, BAND_COUNT> band_index_;
+    std::unordered_map<int, DocumentFingerprint> fingerprints_;
+
+    bool IsNearDuplicateSearchEnabled() const;
+    static uint64_t HashWord(std::string_view word);
+    static uint64_t Mix(uint64_t value);
+    static uint64_t HashBand(const DocumentFingerprint& fingerprint, size_t band);
+    static double EstimateSimilarity(const DocumentFingerprint& lhs, const DocumentFingerprint& rhs);
+    static void AddWordToFingerprint(std::string_view word, DocumentFingerprint& fingerprint, bool with_minhash);
+};
+
+template <typename WordFrequencies>
+DocumentFingerprint DuplicateDetector::ComputeFingerprint(const WordFrequencies& word_freqs, bool with_minhash) {
+    DocumentFingerprint fingerprint;
+    fingerprint.minhash.fill(UINT32_MAX);
+    for (const auto& [word, freq] : word_freqs) {
+        AddWordToFingerprint(word, fingerprint, with_minhash);
+    }
+    return fingerprint;
+}
+
+template <typename ExecutionPolicy>
+std::vector<DuplicateMatch> DuplicateDetector::FindDuplicates(const ExecutionPolicy& policy, const SearchServer& search_server) {
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    std::vector<DocumentFingerprint> fingerprints(document_ids.size());
+    std::transform(policy, document_ids.begin(), document_ids.end(), fingerprints.begin(),
+        [&search_server, with_minhash = IsNearDuplicateSearchEnabled()](int document_id) {
+            return ComputeFingerprint(search_server.GetWordFrequencies(document_id), with_minhash);
+        });
+
+    std::vector<DuplicateMatch> duplicates;
+    for (size_t i = 0; i < document_ids.size(); ++i) {
+        DuplicateMatch match;
+        if (CheckDocument(document_ids[i], fingerprints[i], match)) {
+            duplicates.push_back(match);
+        }
+    }
+    return duplicates;
+}
+
+#endif // DUPLICATE_DETECTOR_H
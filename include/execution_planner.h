@@ -0,0 +1,72 @@
+#ifndef EXECUTION_PLANNER_H
+#define EXECUTION_PLANNER_H
+
+#include <cstddef>
+#include <type_traits>
+
+// Политика исполнения, при которой сервер сам выбирает последовательное или параллельное
+// исполнение и число потоков по оценке работы: FindTopDocuments(adaptive_policy, raw_query)
+struct AdaptivePolicy {
+};
+
+inline constexpr AdaptivePolicy adaptive_policy{};
+
+// Затраты, по которым ExecutionPlanner сравнивает варианты исполнения.
+// Единица работы — обработка одного элемента дерева: документа списка слова или слова документа.
+struct ExecutionCosts {
+    // Единица работы последовательного алгоритма
+    double sequential_item_ns = 20.0;
+    // Единица работы параллельного алгоритма в одном потоке (с блокировками ConcurrentMap)
+    double parallel_item_ns = 40.0;
+    // Запуск параллельного алгоритма, на каждый занятый поток
+    double parallel_dispatch_ns = 10'000.0;
+    // Сколько потоков может занять параллельный алгоритм
+    size_t max_parallelism = 1;
+};
+
+struct ExecutionPlan {
+    // 1 — последовательное исполнение
+    size_t parallelism = 1;
+
+    bool IsParallel() const {
+        return parallelism > 1;
+    }
+};
+
+// Выбирает число потоков, при котором оценка времени минимальна:
+//   последовательно — sequential_item_ns * work;
+//   в p потоков — parallel_dispatch_ns * p + parallel_item_ns * max(work / p, max_task_work).
+class ExecutionPlanner {
+public:
+    explicit ExecutionPlanner(const ExecutionCosts& costs);
+
+    // Планировщик с затратами, измеренными микробенчмарком при первом вызове (несколько миллисекунд)
+    static const ExecutionPlanner& GetCalibrated();
+    // Измеряет затраты на модели поиска по спискам документов в этом процессе
+    static ExecutionCosts Calibrate();
+
+    // work — вся работа, max_task_work — наибольшая часть, которую параллельный алгоритм выполняет
+    // одним потоком (например, список одного слова), task_count — на сколько частей делится работа
+    ExecutionPlan Plan(size_t work, size_t max_task_work, size_t task_count) const;
+
+    const ExecutionCosts& GetCosts() const;
+
+    // Вызывает function, ограничив параллельные алгоритмы внутри неё plan.parallelism потоками
+    template <typename Function>
+    static void Execute(const ExecutionPlan& plan, Function&& function);
+
+private:
+    ExecutionCosts costs_;
+
+    static void ExecuteImpl(size_t parallelism, void (*call)(void*), void* function);
+};
+
+template <typename Function>
+void ExecutionPlanner::Execute(const ExecutionPlan& plan, Function&& function) {
+    // Без std::function: вызов не выделяет память
+    ExecuteImpl(plan.parallelism, [](void* function) {
+        (*static_cast<std::remove_reference_t<Function>*>(function))();
+    }, &function);
+}
+
+#endif // EXECUTION_PLANNER_H
@@ -0,0 +1,101 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <execution>
+#include <type_traits>
+
+struct LatencySummary {
+    uint64_t count = 0;
+    std::chrono::nanoseconds mean{0};
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p99{0};
+    std::chrono::nanoseconds p999{0};
+    std::chrono::nanoseconds max{0};
+};
+
+// Гистограмма задержек с лог-линейными корзинами (как в HdrHistogram):
+// каждый интервал [2^k, 2^(k+1)) наносекунд делится на SUB_BUCKET_COUNT равных корзин,
+// поэтому относительная погрешность перцентилей не превышает 1 / SUB_BUCKET_COUNT.
+// Запись — несколько атомарных инкрементов без блокировок, её можно вызывать из любых потоков.
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 5;
+    static const uint64_t SUB_BUCKET_COUNT = uint64_t{1} << SUB_BUCKET_BITS;
+    static const size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    void Record(std::chrono::nanoseconds latency);
+    void Reset();
+
+    uint64_t GetCount() const;
+    // Значение, не меньше которого fraction записанных значений (с точностью до корзины)
+    std::chrono::nanoseconds GetPercentile(double fraction) const;
+    LatencySummary GetSummary() const;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+
+    static size_t GetBucketIndex(uint64_t value);
+    // Середина диапазона значений корзины
+    static uint64_t GetBucketValue(size_t index);
+};
+
+// Этапы обработки поискового запроса
+enum class QueryStage {
+    PARSE,
+    POSTINGS_SCAN,
+    MINUS_WORDS,
+    SORT,
+    RESULT_BUILD,
+};
+
+enum class QueryExecution {
+    SEQUENTIAL,
+    PARALLEL,
+};
+
+const size_t QUERY_STAGE_COUNT = 5;
+const size_t QUERY_EXECUTION_COUNT = 2;
+
+struct QueryLatencySnapshot {
+    std::array<std::array<LatencySummary, QUERY_STAGE_COUNT>, QUERY_EXECUTION_COUNT> stages;
+
+    const LatencySummary& Get(QueryExecution execution, QueryStage stage) const {
+        return stages[static_cast<size_t>(execution)][static_cast<size_t>(stage)];
+    }
+};
+
+// Гистограммы длительности этапов запроса отдельно для каждой политики исполнения
+class QueryLatencyStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    template <typename ExecutionPolicy>
+    static constexpr QueryExecution GetExecution() {
+        return std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::parallel_policy>
+            ? QueryExecution::PARALLEL
+            : QueryExecution::SEQUENTIAL;
+    }
+
+    // Записывает длительность этапа, начавшегося в stage_start, и возвращает момент его окончания,
+    // чтобы им можно было начать следующий этап
+    Clock::time_point Record(QueryExecution execution, QueryStage stage, Clock::time_point stage_start) {
+        const auto now = Clock::now();
+        histograms_[static_cast<size_t>(execution)][static_cast<size_t>(stage)].Record(now - stage_start);
+        return now;
+    }
+
+    QueryLatencySnapshot GetSnapshot() const;
+    void Reset();
+
+private:
+    std::array<std::array<LatencyHistogram, QUERY_STAGE_COUNT>, QUERY_EXECUTION_COUNT> histograms_;
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,54 @@
+#ifndef LEVENSHTEIN_AUTOMATON_H
+#define LEVENSHTEIN_AUTOMATON_H
+
+#include "string_processing.h"
+#include "term_dictionary.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Автомат, принимающий слова на расстоянии Левенштейна не больше max_distance от word.
+// Расстояние считается в символах UTF-8: вставка или замена буквы кириллицы стоит 1, а не 2.
+// Состояние — строка таблицы динамического программирования с расстояниями,
+// ограниченными сверху max_distance + 1: такой автомат детерминирован и его можно
+// вести по общим префиксам отсортированного словаря.
+class LevenshteinAutomaton {
+public:
+    using State = std::vector<uint8_t>;
+
+    LevenshteinAutomaton(std::string_view word, int max_distance);
+
+    State GetStartState() const;
+    // c — один символ UTF-8. to может совпадать по размеру с from, тогда память не выделяется
+    void Step(const State& from, std::string_view c, State& to) const;
+
+    bool IsMatch(const State& state) const;
+    // Можно ли ещё прийти в принимающее состояние
+    bool CanMatch(const State& state) const;
+    int GetDistance(const State& state) const;
+    // Наименьшая строка next, большая всех строк, начинающихся символом after, с которой совпадение
+    // ещё возможно: следующий символ целиком или ключ для перехода по словарю. false, если такой нет.
+    bool FindNextLiveChar(const State& state, std::string_view after, std::string& next) const;
+
+private:
+    // Символы UTF-8 слова
+    std::vector<std::string> characters_;
+    uint8_t max_distance_;
+};
+
+struct FuzzyTerm {
+    std::string term;
+    int distance = 0;
+};
+
+// Термы словаря на расстоянии не больше max_distance от word, ближайшие первыми, не больше limit.
+// Автомат ведётся по термам с общими префиксами. Префикс, после которого совпадение
+// невозможно, пропускается переходом сразу к наименьшему префиксу, где оно возможно.
+std::vector<FuzzyTerm> FindFuzzyTerms(const TermDictionary& dictionary, std::string_view word, int max_distance, size_t limit);
+
+// Расстояние Левенштейна в символах UTF-8, для сравнения с автоматом
+int ComputeEditDistance(std::string_view lhs, std::string_view rhs);
+
+#endif // LEVENSHTEIN_AUTOMATON_H
@@ -0,0 +1,53 @@
+#ifndef LOAD_TESTER_H
+#define LOAD_TESTER_H
+
+#include "document.h"
+#include "latency_histogram.h"
+#include "search_server.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Запись журнала запросов: запрос<TAB>статус<TAB>K, статус и K необязательны
+struct QueryLogEntry {
+    std::string query;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    // Сколько документов запросить, по умолчанию как в FindTopDocuments
+    size_t top_k = MAX_RESULT_DOCUMENT_COUNT;
+};
+
+// При ошибке формата выбрасывает std::invalid_argument
+QueryLogEntry ParseQueryLogEntry(std::string_view line);
+
+// Пустые строки пропускаются
+std::vector<QueryLogEntry> ReadQueryLog(const std::string& path);
+
+struct LoadTestOptions {
+    // Число клиентских потоков
+    size_t concurrency = 1;
+    // 0 — замкнутый цикл: каждый клиент отправляет следующий запрос сразу после ответа.
+    // Иначе открытый цикл: запросы отправляются по расписанию с заданной частотой независимо от ответов.
+    double target_qps = 0.0;
+    // 0 — журнал воспроизводится один раз, иначе по кругу до заданного числа запросов
+    size_t request_count = 0;
+    bool use_parallel_policy = false;
+};
+
+struct LoadTestReport {
+    size_t request_count = 0;
+    // Запросы, на которых поиск выбросил исключение
+    size_t error_count = 0;
+    double seconds = 0.0;
+    // В открытом цикле задержка отсчитывается от запланированного момента отправки,
+    // поэтому время ожидания свободного клиента тоже учитывается
+    LatencySummary latency;
+
+    double GetThroughput() const;
+};
+
+LoadTestReport RunLoadTest(const SearchServer& search_server, const std::vector<QueryLogEntry>& query_log,
+                           const LoadTestOptions& options = {});
+
+#endif // LOAD_TESTER_H
@@ -1,5 +1,11 @@
 #pragma once
+#include "search_server.h"
+
 #include <algorithm>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <type_traits>
 #include <vector>
 #include <iostream>
 
@@ -71,3 +77,93 @@ template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
     return Paginator(begin(c), end(c), page_size);
 }
+
+
+// Постраничный обход без материализации всей выдачи: страница запрашивается
+// у fetch_page только при переходе к ней. fetch_page(const std::optional<Cursor>&)
+// возвращает страницу с полями documents и next_cursor, для первой страницы курсор пуст.
+template <typename Cursor, typename FetchPage>
+class LazyPaginator {
+public:
+    using Page = std::invoke_result_t<const FetchPage&, const std::optional<Cursor>&>;
+
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = decltype(std::declval<Page>().documents);
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        Iterator() = default;
+
+        explicit Iterator(const FetchPage* fetch_page)
+            : fetch_page_(fetch_page)
+            , page_((*fetch_page)(std::nullopt)) {
+            if (page_->documents.empty()) {
+                fetch_page_ = nullptr;
+            }
+        }
+
+        reference operator*() const {
+            return page_->documents;
+        }
+
+        pointer operator->() const {
+            return &page_->documents;
+        }
+
+        Iterator& operator++() {
+            if (page_->next_cursor) {
+                page_ = (*fetch_page_)(page_->next_cursor);
+            } else {
+                page_.reset();
+            }
+            if (!page_ || page_->documents.empty()) {
+                fetch_page_ = nullptr;
+            }
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return fetch_page_ == nullptr && other.fetch_page_ == nullptr;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const FetchPage* fetch_page_ = nullptr;
+        std::optional<Page> page_;
+    };
+
+    explicit LazyPaginator(FetchPage fetch_page)
+        : fetch_page_(std::move(fetch_page)) {
+    }
+
+    Iterator begin() const {
+        return Iterator(&fetch_page_);
+    }
+
+    Iterator end() const {
+        return {};
+    }
+
+private:
+    FetchPage fetch_page_;
+};
+
+template <typename Cursor, typename FetchPage>
+auto PaginateLazily(FetchPage fetch_page) {
+    return LazyPaginator<Cursor, FetchPage>(std::move(fetch_page));
+}
+
+// Страницы выдачи запроса по page_size документов, без ограничения MAX_RESULT_DOCUMENT_COUNT
+inline auto PaginateSearch(const SearchServer& search_server, std::string raw_query, size_t page_size,
+                           DocumentStatus status = DocumentStatus::ACTUAL) {
+    return PaginateLazily<SearchCursor>([&search_server, raw_query = std::move(raw_query), page_size, status]
+                                        (const std::optional<SearchCursor>& after) {
+        return search_server.FindDocumentsPage(raw_query, status, PageRequest{page_size, 0, after});
+    });
+}
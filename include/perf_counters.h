@@ -0,0 +1,79 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include "log_duration.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#define LOG_PERF_COUNTERS(x) PerfCountersGuard UNIQUE_VAR_NAME_PROFILE(x)
+#define LOG_PERF_COUNTERS_STREAM(x, stream) PerfCountersGuard UNIQUE_VAR_NAME_PROFILE(x, stream)
+
+enum class PerfCounter {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_READ_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES,
+};
+
+const size_t PERF_COUNTER_COUNT = 5;
+
+struct PerfCounterValues {
+    std::chrono::nanoseconds duration{0};
+    // Пустое значение — счётчик недоступен
+    std::array<std::optional<uint64_t>, PERF_COUNTER_COUNT> counters;
+
+    const std::optional<uint64_t>& Get(PerfCounter counter) const {
+        return counters[static_cast<size_t>(counter)];
+    }
+};
+
+std::string_view GetPerfCounterName(PerfCounter counter);
+
+std::ostream& operator<<(std::ostream& output, const PerfCounterValues& values);
+
+// Аппаратные счётчики производительности текущего потока (perf_event_open, только Linux).
+// Каждый счётчик открывается отдельно: если ядро или права не позволяют открыть часть из них
+// (perf_event_paranoid, виртуальная машина), остальные продолжают работать,
+// а без счётчиков остаётся только время выполнения.
+// События потоков TBB в параллельных алгоритмах не учитываются.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool IsAvailable(PerfCounter counter) const;
+    bool IsAnyAvailable() const;
+
+    void Start();
+    PerfCounterValues Stop();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::array<int, PERF_COUNTER_COUNT> descriptors_;
+    Clock::time_point start_time_;
+};
+
+// Аналог LogDuration: при выходе из области видимости выводит время и приращения счётчиков
+class PerfCountersGuard {
+public:
+    explicit PerfCountersGuard(std::string_view id, std::ostream& stream = std::cerr);
+    ~PerfCountersGuard();
+
+private:
+    std::ostream& stream_;
+    const std::string id_;
+    PerfCounters counters_;
+};
+
+#endif // PERF_COUNTERS_H
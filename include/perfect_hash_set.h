@@ -0,0 +1,47 @@
+#ifndef PERFECT_HASH_SET_H
+#define PERFECT_HASH_SET_H
+
+#include "counting_allocator.h"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Неизменяемое множество строк с минимальной совершенной хеш-функцией (hash and displace):
+// слова разбиты на группы по хешу, для каждой группы подобрано смещение, при котором её слова
+// попадают в свободные ячейки таблицы из ровно стольких ячеек, сколько слов. Поиск хеширует слово
+// один раз и читает одну ячейку; полный хеш в ячейке отсекает отсутствующие слова без сравнения строк,
+// а маска длин — ещё до хеширования.
+class PerfectHashSet {
+public:
+    // Среднее число слов в группе: чем больше, тем меньше смещений хранится и дольше построение
+    static const size_t BUCKET_SIZE = 4;
+
+    PerfectHashSet() = default;
+    explicit PerfectHashSet(MemoryCounter* counter);
+
+    // words не повторяются
+    void Assign(const std::vector<std::string_view>& words);
+
+    bool Contains(std::string_view word) const;
+    size_t GetSize() const;
+
+private:
+    struct Slot {
+        uint64_t hash;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    std::vector<Slot, CountingAllocator<Slot>> slots_;
+    std::vector<uint32_t, CountingAllocator<uint32_t>> seeds_;
+    std::vector<char, CountingAllocator<char>> chars_;
+    uint64_t salt_ = 0;
+    // Бит min(длина, 63) установлен, если в множестве есть слово такой длины
+    uint64_t length_mask_ = 0;
+
+    size_t GetBucket(uint64_t hash) const;
+    size_t GetSlot(uint64_t hash, uint32_t seed) const;
+};
+
+#endif // PERFECT_HASH_SET_H
@@ -0,0 +1,34 @@
+#ifndef POSITION_LIST_H
+#define POSITION_LIST_H
+
+#include "counting_allocator.h"
+
+#include <cstdint>
+#include <vector>
+
+// Возрастающие позиции слова в документе. Хранятся разности соседних позиций
+// в формате varint: по 7 бит в байте, старший бит — признак продолжения,
+// поэтому близкие позиции занимают по одному байту.
+class PositionList {
+public:
+    using allocator_type = CountingAllocator<uint8_t>;
+
+    PositionList() = default;
+    explicit PositionList(const allocator_type& allocator);
+    PositionList(const PositionList& other, const allocator_type& allocator);
+    PositionList(PositionList&& other, const allocator_type& allocator);
+
+    // position не меньше последней добавленной
+    void Append(uint32_t position);
+    std::vector<uint32_t> Decode() const;
+
+    size_t GetSize() const;
+    size_t GetByteSize() const;
+
+private:
+    std::vector<uint8_t, allocator_type> bytes_;
+    uint32_t last_position_ = 0;
+    uint32_t size_ = 0;
+};
+
+#endif // POSITION_LIST_H
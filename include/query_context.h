@@ -0,0 +1,96 @@
+#ifndef QUERY_CONTEXT_H
+#define QUERY_CONTEXT_H
+
+#include "concurrent_map.h"
+#include "document.h"
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+// Память для временных данных запросов поиска, сохраняющая ёмкость между запросами:
+// буфер слов запроса и найденных документов, карта релевантности параллельного поиска
+// и вектор результата. После первых запросов поиск не выделяет память в куче.
+// Контекст используется одним потоком за раз.
+class QueryContext {
+public:
+    static constexpr size_t DEFAULT_ARENA_BYTES = 16 * 1024;
+    // Больше этого буфер не растёт: память редких больших запросов возвращается в кучу
+    static constexpr size_t MAX_ARENA_BYTES = 16 * 1024 * 1024;
+    static constexpr size_t RELEVANCE_BUCKET_COUNT = 12;
+
+    explicit QueryContext(size_t arena_bytes = DEFAULT_ARENA_BYTES);
+
+    QueryContext(const QueryContext&) = delete;
+    QueryContext& operator=(const QueryContext&) = delete;
+
+    // Контекст, установленный в потоке через QueryContextScope, иначе собственный контекст потока
+    static QueryContext& GetCurrent();
+
+    // Возвращает контексту вектор результата поиска, чтобы следующий запрос заполнил его без выделения памяти
+    void Recycle(std::vector<Document>&& documents);
+
+    size_t GetArenaBytes() const;
+
+    // Память контекста на время одного запроса, освобождается вся сразу при уничтожении.
+    // Если буфера не хватило, он увеличивается к следующему запросу. Если контекст уже занят
+    // запросом этого потока (запрос из предиката или из задачи, которую поток взял,
+    // ожидая параллельный алгоритм), используется временная память из кучи.
+    class Lease {
+    public:
+        explicit Lease(QueryContext& context);
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        std::pmr::memory_resource* GetResource();
+        // Пустая карта релевантности
+        ConcurrentMap<int, double>& GetRelevanceMap();
+        // Пустой вектор для результата поиска
+        std::vector<Document> TakeResults();
+
+    private:
+        QueryContext* context_ = nullptr;
+        std::optional<std::pmr::monotonic_buffer_resource> arena_;
+        std::optional<ConcurrentMap<int, double>> relevance_map_;
+    };
+
+private:
+    // Память сверх буфера: её объём задаёт новый размер буфера
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        size_t TakeRequestedBytes();
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        size_t requested_bytes_ = 0;
+    };
+
+    std::unique_ptr<std::byte[]> arena_;
+    size_t arena_bytes_ = 0;
+    OverflowResource overflow_;
+    ConcurrentMap<int, double> relevance_map_;
+    std::vector<Document> results_;
+    bool is_leased_ = false;
+};
+
+// Устанавливает контекст для запросов поиска текущего потока на время своей жизни
+class QueryContextScope {
+public:
+    explicit QueryContextScope(QueryContext& context);
+    ~QueryContextScope();
+
+    QueryContextScope(const QueryContextScope&) = delete;
+    QueryContextScope& operator=(const QueryContextScope&) = delete;
+
+private:
+    QueryContext* previous_;
+};
+
+#endif // QUERY_CONTEXT_H
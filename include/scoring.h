@@ -0,0 +1,81 @@
+#ifndef SCORING_H
+#define SCORING_H
+
+#include <cmath>
+#include <cstddef>
+
+// Статистика индекса на момент запроса, общая для всех слов запроса
+struct ScoringContext {
+    size_t document_count = 0;
+    // Величина, обратная средней длине документа в словах без стоп-слов (0 для пустого индекса)
+    double inverse_average_document_length = 0.0;
+};
+
+// Политики ранжирования передаются в FindTopDocuments и FindDocumentsPage параметром шаблона,
+// поэтому их функции встраиваются в цикл по спискам документов.
+//   ComputeWordWeight — вес слова запроса, считается один раз на слово;
+//   ComputeScore — вклад слова в релевантность документа по доле слова в документе (term_freq)
+//   и длине документа;
+//   Accumulate — объединяет вклады слов запроса в релевантность документа;
+//   IS_MONOTONE_IN_TERM_FREQ — релевантность по одному слову не убывает с term_freq,
+//   поэтому запрос из одного слова можно остановить досрочно на списке, упорядоченном по term_freq.
+
+// Релевантность — сумма TF-IDF слов запроса
+struct TfIdfScoring {
+    static constexpr bool IS_MONOTONE_IN_TERM_FREQ = true;
+
+    static double ComputeWordWeight(const ScoringContext& context, size_t word_document_count) {
+        return std::log(context.document_count * 1.0 / word_document_count);
+    }
+
+    static double ComputeScore(const ScoringContext&, double word_weight, double term_freq, size_t) {
+        return term_freq * word_weight;
+    }
+
+    static double Accumulate(double relevance, double score) {
+        return relevance + score;
+    }
+};
+
+// Okapi BM25: частота слова насыщается, длинные документы штрафуются относительно средней длины
+struct Bm25Scoring {
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+    // Вклад зависит и от длины документа
+    static constexpr bool IS_MONOTONE_IN_TERM_FREQ = false;
+
+    // Неотрицательный вариант IDF, как в Lucene
+    static double ComputeWordWeight(const ScoringContext& context, size_t word_document_count) {
+        return std::log(1.0 + (context.document_count - word_document_count + 0.5) / (word_document_count + 0.5));
+    }
+
+    static double ComputeScore(const ScoringContext& context, double word_weight, double term_freq, size_t document_length) {
+        const double word_count = term_freq * document_length;
+        const double length_norm = K1 * (1.0 - B + B * document_length * context.inverse_average_document_length);
+        return word_weight * word_count * (K1 + 1.0) / (word_count + length_norm);
+    }
+
+    static double Accumulate(double relevance, double score) {
+        return relevance + score;
+    }
+};
+
+// Все найденные документы получают релевантность 1: запрос работает как фильтр,
+// порядок выдачи определяется рейтингом и id
+struct ConstantScoring {
+    static constexpr bool IS_MONOTONE_IN_TERM_FREQ = false;
+
+    static double ComputeWordWeight(const ScoringContext&, size_t) {
+        return 1.0;
+    }
+
+    static double ComputeScore(const ScoringContext&, double, double, size_t) {
+        return 1.0;
+    }
+
+    static double Accumulate(double, double score) {
+        return score;
+    }
+};
+
+#endif // SCORING_H
@@ -1,179 +1,790 @@
 #ifndef SEARCHSERVER_H
 #define SEARCHSERVER_H
 
+#include "counting_allocator.h"
 #include "document.h"
+#include "execution_planner.h"
+#include "latency_histogram.h"
+#include "levenshtein_automaton.h"
+#include "position_list.h"
+#include "scoring.h"
+#include "term_dictionary.h"
 #include "string_processing.h"
+#include "trace.h"
 
 #include <execution>
+#include <limits>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <scoped_allocator>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <vector>
 #include "concurrent_map.h"
+#include "perfect_hash_set.h"
+#include "query_context.h"
 
 // Количество выводимых документов в запросе
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
-// Максимальное количество потоков выполенения
-const int MAX_COUNTS = 12;
+// Наибольшее расстояние Левенштейна в нечётком слове запроса word~N
+const int MAX_FUZZY_EDIT_DISTANCE = 2;
+
+// Память, занятая структурами сервера, в байтах. Считается аллокаторами контейнеров,
+// поэтому включает служебные данные узлов и выравнивание, но не сам объект SearchServer
+// и не короткие строки, хранящиеся внутри объекта строки.
+struct MemoryStats {
+    size_t document_texts = 0;
+    // Рейтинг и статус документов
+    size_t documents = 0;
+    // Слова индекса
+    size_t dictionary = 0;
+    // Списки документов для каждого слова
+    size_t postings = 0;
+    // Слова и частоты каждого документа
+    size_t document_words = 0;
+    size_t document_ids = 0;
+    size_t stop_words = 0;
+    // Позиции слов в документах, если включён позиционный индекс
+    size_t positions = 0;
+    // Сжатый словарь для запросов с шаблонами, строится при первом таком запросе
+    size_t term_dictionary = 0;
+    // Документы, упорядоченные по рейтингу
+    size_t rating_index = 0;
+    // Списки документов, упорядоченные по term_freq, если они включены
+    size_t impact_postings = 0;
+
+    // Словарь, списки документов, позиции, сжатый словарь и списки по term_freq
+    size_t GetIndexBytes() const;
+    size_t GetTotalBytes() const;
+};
+
+struct SearchServerOptions {
+    // Хранить позиции слов в документах. Нужны для фразовых запросов "..." и "..."~N,
+    // без них кавычки в запросе считаются обычными символами слова.
+    bool positional_index = false;
+    // Сколько слов индекса может подставить одно слово запроса с * или ? (первые по алфавиту)
+    // или нечёткое слово word~N (ближайшие).
+    size_t max_term_expansions = 64;
+    // Источник памяти для индекса и текстов документов, nullptr — глобальный new/delete. Должен
+    // существовать дольше сервера. RemoveDocument(execution::par) освобождает память из нескольких
+    // потоков, поэтому ему нужен потокобезопасный источник, например synchronized_pool_resource.
+    // То же относится к RemoveDocument(adaptive_policy), который может выбрать параллельное исполнение.
+    // Для индекса, из которого документы не удаляются, подходит monotonic_buffer_resource.
+    std::pmr::memory_resource* memory_resource = nullptr;
+    // Хранить для каждого слова копию списка документов по убыванию term_freq. Запрос из одного слова
+    // без минус-слов и фраз с ранжированием TF-IDF обходит её и останавливается, как только
+    // оставшиеся документы уже не могут попасть в выдачу.
+    bool impact_ordered_postings = false;
+    // Нормализовать тексты документов, стоп-слова и запросы: проверка UTF-8, нижний регистр для латиницы
+    // и кириллицы, знаки препинания — разделители слов (дефис внутри слова сохраняется). Сервер хранит
+    // нормализованные тексты документов, и MatchDocument возвращает нормализованные слова.
+    bool normalize_text = false;
+    // Планировщик для вызовов с adaptive_policy, должен существовать дольше сервера.
+    // nullptr — планировщик с затратами, измеренными при первом таком вызове в процессе.
+    const ExecutionPlanner* execution_planner = nullptr;
+    // Слова запроса с * и ? — шаблоны по словам индекса (rob*, ro?e).
+    // Без этого * и ? считаются обычными символами слова.
+    bool wildcard_query_words = false;
+    // Слова запроса word~ и word~N — нечёткий поиск по словам индекса.
+    // Без этого ~N считается частью слова (c++~2).
+    bool fuzzy_query_words = false;
+};
+
+// Диапазон рейтинга документов, границы включаются
+struct RatingRange {
+    int min_rating = std::numeric_limits<int>::min();
+    int max_rating = std::numeric_limits<int>::max();
+
+    bool Contains(int rating) const {
+        return min_rating <= rating && rating <= max_rating;
+    }
+};
+
+// Ключ ранжирования последнего документа страницы. Следующая страница начинается
+// с документов, ранжированных строго после него: по убыванию релевантности и рейтинга,
+// при равенстве — по возрастанию id.
+struct SearchCursor {
+    double relevance = 0.0;
+    int rating = 0;
+    int id = 0;
+};
+
+struct PageRequest {
+    size_t page_size = MAX_RESULT_DOCUMENT_COUNT;
+    // Сколько документов пропустить после курсора (или от начала выдачи)
+    size_t offset = 0;
+    std::optional<SearchCursor> after = std::nullopt;
+};
+
+struct SearchPage {
+    std::vector<Document> documents;
+    // Отсутствует, если страница последняя
+    std::optional<SearchCursor> next_cursor;
+};
 
 class SearchServer {
 public:
+    // Контейнеры с аллокатором, считающим память. Это не std::map<std::string_view, double> и не std::set<int>:
+    // результат GetWordFrequencies и итераторы begin()/end() следует принимать в эти типы или в auto
+    using WordFrequencies = std::map<std::string_view, double, std::less<std::string_view>,
+                                     CountingAllocator<std::pair<const std::string_view, double>>>;
+    using DocumentIds = std::set<int, std::less<int>, CountingAllocator<int>>;
+
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
+    explicit SearchServer(const StringContainer& stop_words, const SearchServerOptions& options = {});
 
-    explicit SearchServer(const std::string& stop_words_text);
-    explicit SearchServer(const char*  stop_words_text);
-    explicit SearchServer(std::string_view stop_words_text);
+    explicit SearchServer(const std::string& stop_words_text, const SearchServerOptions& options = {});
+    explicit SearchServer(const char*  stop_words_text, const SearchServerOptions& options = {});
+    explicit SearchServer(std::string_view stop_words_text, const SearchServerOptions& options = {});
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
-    template <typename DocumentPredicate>
+    // Пакетное добавление документов: разбиение на слова выполняется согласно политике,
+    // вставка в индекс — последовательно. При ошибке ни один документ пакета не добавляется.
+    void AddDocuments(const std::vector<DocumentRecord>& documents);
+    void AddDocuments(const std::execution::sequenced_policy&, const std::vector<DocumentRecord>& documents);
+    void AddDocuments(const std::execution::parallel_policy&, const std::vector<DocumentRecord>& documents);
+
+    // Разбивает тексты пакета на слова, не изменяя индекс. Обращается только к стоп-словам,
+    // поэтому может выполняться в другом потоке одновременно с добавлением документов.
+    using DocumentsWords = std::vector<std::vector<std::string_view>>;
+    DocumentsWords TokenizeDocuments(const std::execution::sequenced_policy&, const std::vector<DocumentRecord>& documents) const;
+    DocumentsWords TokenizeDocuments(const std::execution::parallel_policy&, const std::vector<DocumentRecord>& documents) const;
+    // Добавляет пакет, уже разбитый на слова с помощью TokenizeDocuments
+    void AddDocuments(const std::vector<DocumentRecord>& documents, DocumentsWords documents_words);
+
+    // Scoring — политика ранжирования из scoring.h: FindTopDocuments<Bm25Scoring>(raw_query)
+    template <typename Scoring = TfIdfScoring, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
 
-    template <typename DocumentPredicate, typename ExecutionPolicy>
+    template <typename Scoring = TfIdfScoring, typename DocumentPredicate, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
 
 
+    template <typename Scoring = TfIdfScoring>
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
-    template <typename ExecutionPolicy>
+    template <typename Scoring = TfIdfScoring, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const;
 
+    template <typename Scoring = TfIdfScoring>
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
-    template <typename ExecutionPolicy>
+    template <typename Scoring = TfIdfScoring, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const;
 
-    std::set<int>::const_iterator begin() const;
-    std::set<int>::const_iterator end() const;
+    // Фильтр по рейтингу через вторичный индекс: если в диапазон попадает меньше документов,
+    // чем в списки слов запроса, документы диапазона ищутся в списках вместо их полного обхода
+    template <typename Scoring = TfIdfScoring>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const RatingRange& ratings,
+                                           DocumentStatus status = DocumentStatus::ACTUAL) const;
+    template <typename Scoring = TfIdfScoring, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, const RatingRange& ratings,
+                                           DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    // Страница выдачи без ограничения MAX_RESULT_DOCUMENT_COUNT. Сортируются только первые
+    // offset + page_size документов после курсора. При page_size == 0 выбрасывает std::invalid_argument.
+    template <typename Scoring = TfIdfScoring, typename DocumentPredicate>
+    SearchPage FindDocumentsPage(std::string_view raw_query, DocumentPredicate document_predicate, const PageRequest& request) const;
+    template <typename Scoring = TfIdfScoring, typename DocumentPredicate, typename ExecutionPolicy>
+    SearchPage FindDocumentsPage(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate, const PageRequest& request) const;
+
+    template <typename Scoring = TfIdfScoring>
+    SearchPage FindDocumentsPage(std::string_view raw_query, DocumentStatus status, const PageRequest& request) const;
+    template <typename Scoring = TfIdfScoring, typename ExecutionPolicy>
+    SearchPage FindDocumentsPage(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status, const PageRequest& request) const;
+
+    template <typename Scoring = TfIdfScoring>
+    SearchPage FindDocumentsPage(std::string_view raw_query, const PageRequest& request) const;
+    template <typename Scoring = TfIdfScoring, typename ExecutionPolicy>
+    SearchPage FindDocumentsPage(const ExecutionPolicy& policy, std::string_view raw_query, const PageRequest& request) const;
+
+    DocumentIds::const_iterator begin() const;
+    DocumentIds::const_iterator end() const;
 
     using MatchDocumentResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
     MatchDocumentResult MatchDocument(std::string_view raw_query, int document_id) const;
     MatchDocumentResult MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const;
     MatchDocumentResult MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const;
+    // Параллельно, только если слов запроса много для числа слов документа
+    MatchDocumentResult MatchDocument(const AdaptivePolicy&, std::string_view raw_query, int document_id) const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // Матчинг одного запроса с несколькими документами: запрос разбирается один раз
+    std::vector<MatchDocumentResult> MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const;
+    std::vector<MatchDocumentResult> MatchDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, const std::vector<int>& document_ids) const;
+    std::vector<MatchDocumentResult> MatchDocuments(const std::execution::parallel_policy&, std::string_view raw_query, const std::vector<int>& document_ids) const;
+
+    const WordFrequencies& GetWordFrequencies(int document_id) const;
     int GetDocumentCount() const;
+    // Число различных слов в индексе
+    size_t GetWordCount() const;
 
     void RemoveDocument(int document_id);
     void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
     void RemoveDocument(const std::execution::parallel_policy&, int document_id);
+    void RemoveDocument(const AdaptivePolicy&, int document_id);
+
+    // Перцентили длительности этапов FindTopDocuments по политикам исполнения
+    QueryLatencySnapshot GetQueryLatencyStats() const;
+    void ResetQueryLatencyStats();
+
+    // Счётчики обновляются при каждом выделении памяти, поэтому вызов дешёвый
+    MemoryStats GetMemoryStats() const;
 
 private:
+    using DocumentText = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
+
     struct DocumentData {
         int rating;
         DocumentStatus status;
-        std::string text;
+        DocumentText text;
+        // Число слов без стоп-слов, нужно для нормировки по длине в BM25
+        size_t word_count = 0;
+    };
+
+    // Вложенные контейнеры получают аллокатор с собственным счётчиком от внешнего
+    template <typename Key, typename Value>
+    using NestedMap = std::map<Key, Value, std::less<Key>,
+                               std::scoped_allocator_adaptor<CountingAllocator<std::pair<const Key, Value>>,
+                                                             typename Value::allocator_type>>;
+    using DocumentFrequencies = std::map<int, double, std::less<int>, CountingAllocator<std::pair<const int, double>>>;
+    using WordPostings = NestedMap<std::string_view, DocumentFrequencies>;
+    using DocumentToWordFrequencies = NestedMap<int, WordFrequencies>;
+    using Documents = std::map<int, DocumentData, std::less<int>, CountingAllocator<std::pair<const int, DocumentData>>>;
+    // Набор стоп-слов задаётся в конструкторе и проверяется для каждого слова документов и запросов
+    using StopWords = PerfectHashSet;
+    using WordPositions = NestedMap<std::string_view, PositionList>;
+    using DocumentToWordPositions = NestedMap<int, WordPositions>;
+    struct ImpactPosting {
+        double term_freq;
+        int document_id;
+    };
+    // По убыванию term_freq, при равенстве — по возрастанию id
+    struct ImpactOrder {
+        bool operator()(const ImpactPosting& lhs, const ImpactPosting& rhs) const {
+            return std::tie(rhs.term_freq, lhs.document_id) < std::tie(lhs.term_freq, rhs.document_id);
+        }
+    };
+    using ImpactPostings = std::set<ImpactPosting, ImpactOrder, CountingAllocator<ImpactPosting>>;
+    using WordImpacts = NestedMap<std::string_view, ImpactPostings>;
+    // Пары (рейтинг, id)
+    using RatingIndex = std::set<std::pair<int, int>, std::less<std::pair<int, int>>, CountingAllocator<std::pair<int, int>>>;
+
+    struct MemoryCounters {
+        MemoryCounter document_texts;
+        MemoryCounter documents;
+        MemoryCounter dictionary;
+        MemoryCounter postings;
+        MemoryCounter document_words;
+        MemoryCounter document_ids;
+        MemoryCounter stop_words;
+        MemoryCounter positions;
+        MemoryCounter term_dictionary;
+        MemoryCounter rating_index;
+        MemoryCounter impact_postings;
     };
-    const TransparentStringSet stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
+
+    // Словарь для слов запроса с шаблонами и нечётких слов, обновляется при записи, а не в запросе.
+    // Новые слова индекса попадают в малый словарь recent, удалённые из main отмечаются в removed_terms.
+    // Когда изменений становится больше порога, все слова индекса заново записываются в main.
+    struct TermDictionaries {
+        explicit TermDictionaries(MemoryCounter* counter)
+            : main(counter)
+            , recent(counter) {
+        }
+
+        TermDictionary main;
+        TermDictionary recent;
+        std::set<std::string, std::less<>> recent_terms;
+        std::set<std::string, std::less<>> removed_terms;
+        bool is_recent_dirty = false;
+    };
+
+    // Счётчики создаются первыми и не перемещаются вместе с сервером
+    std::unique_ptr<MemoryCounters> memory_counters_;
+    SearchServerOptions options_;
+    const std::string query_kept_punctuation_;
+    const StopWords stop_words_;
+    WordPostings word_to_document_freqs_;
+    DocumentToWordFrequencies document_to_word_freqs_;
+    Documents documents_;
+    DocumentIds document_ids_;
+    RatingIndex rating_index_;
+    // Сумма word_count всех документов
+    size_t total_word_count_ = 0;
+    // Заполняется только при SearchServerOptions::positional_index
+    DocumentToWordPositions document_to_word_positions_;
+    // Заполняется только при SearchServerOptions::impact_ordered_postings.
+    // Ключи те же, что в word_to_document_freqs_, и переносятся вместе с ними.
+    WordImpacts word_impacts_;
+    // Заполняется только при SearchServerOptions::wildcard_query_words или fuzzy_query_words
+    TermDictionaries term_dictionaries_;
+    std::unique_ptr<QueryLatencyStats> query_latency_stats_;
+
+    // Аллокатор вложенного контейнера: внешний учитывает память в outer_counter, внутренний — в inner_counter
+    template <typename Container>
+    static typename Container::allocator_type MakeNestedAllocator(MemoryCounter& outer_counter, MemoryCounter& inner_counter,
+                                                                  std::pmr::memory_resource* resource) {
+        using Allocator = typename Container::allocator_type;
+        return Allocator(typename Allocator::outer_allocator_type(&outer_counter, resource),
+                         typename Container::mapped_type::allocator_type(&inner_counter, resource));
+    }
+    // Знаки препинания, которые нормализация оставляет в словах документов
+    static constexpr std::string_view DOCUMENT_KEPT_PUNCTUATION = "-";
+    // Меньше стольких изменений словаря слияние в TermDictionaries::main не выполняется
+    static constexpr size_t MIN_TERM_DICTIONARY_MERGE_SIZE = 1024;
+
+    // Знаки, которые нормализация оставляет в запросах: дефис и синтаксис запроса, включённый в options.
+    // Остальные знаки заменяются пробелами так же, как в документах.
+    static std::string MakeQueryKeptPunctuation(const SearchServerOptions& options);
+    static StopWords MakeStopWords(const TransparentStringSet& stop_words, MemoryCounter& counter, bool normalize_text);
+    DocumentText MakeDocumentText(std::string_view text) const;
 
     bool IsStopWord(std::string_view word) const;
     static bool IsValidWord(std::string_view word);
     std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+    // Слова документа без стоп-слов с учётом нормализации; указывают на text
+    std::vector<std::string_view> TokenizeDocument(std::string_view text) const;
     static int ComputeAverageRating(const std::vector<int>& ratings);
+    void IndexDocument(int document_id, const std::vector<std::string_view>& words);
+    // Позиции считаются по всем словам текста, включая стоп-слова
+    void IndexPositions(int document_id);
+    void IndexImpacts(int document_id);
+    // Вызывается после удаления документа из списка слова: удаляет пустой список,
+    // а ключ, указывающий на текст удаляемого документа, переносит на текст оставшегося
+    void ReleaseWordKey(std::string_view word, int removed_document_id);
+
+    bool HasTermDictionary() const;
+    void AddDictionaryTerm(std::string_view word);
+    void RemoveDictionaryTerm(std::string_view word);
+    // Вызывается в конце каждой записи: перестраивает recent или, если изменений больше порога, main.
+    // Слияние стоит O(числа слов), поэтому выполняется не чаще раза в sqrt(числа слов) изменений.
+    void UpdateTermDictionary();
+    // Сколько слов брать из main, чтобы после отбрасывания удалённых осталось max_term_expansions
+    size_t GetMainDictionaryLimit() const;
+    // Слова индекса, подходящие под шаблон, не больше options_.max_term_expansions
+    std::vector<std::string_view> ExpandPattern(std::string_view pattern) const;
+    // Слова индекса на расстоянии не больше max_edit_distance, ближайшие первыми
+    std::vector<std::string_view> ExpandFuzzy(std::string_view word, int max_edit_distance) const;
+
+    void CheckNewDocumentIds(const std::vector<DocumentRecord>& documents) const;
+
+    template <typename ExecutionPolicy>
+    DocumentsWords TokenizeDocumentsImpl(const ExecutionPolicy& policy, const std::vector<DocumentRecord>& documents) const;
 
     struct QueryWord {
         std::string_view data;
         bool is_minus;
         bool is_stop;
+        // Содержит * или ?
+        bool is_pattern;
+        // Больше нуля для нечёткого слова word~N
+        int max_edit_distance;
     };
 
     QueryWord ParseQueryWord(std::string_view text) const;
 
-    struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+    struct Phrase {
+        // Слова фразы без стоп-слов и их смещения от начала фразы с учётом стоп-слов
+        std::vector<std::string_view> words;
+        std::vector<uint32_t> offsets;
+        // Сколько лишних позиций допускается между словами фразы в сумме
+        uint32_t slop = 0;
     };
 
-    Query ParseQuery(std::string_view text, bool skip_sort = false) const;
-
-    double ComputeWordInverseDocumentFreq(std::string_view word) const;
-
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    // Слова запроса размещаются в памяти запроса, переданной в ParseQuery
+    struct Query {
+        explicit Query(std::pmr::memory_resource* resource)
+            : normalized_text(resource)
+            , plus_words(resource)
+            , minus_words(resource) {
+        }
 
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy& policy, const Query& query, DocumentPredicate document_predicate) const;
+        // При SearchServerOptions::normalize_text слова запроса указывают на этот текст
+        std::pmr::vector<char> normalized_text;
+        std::pmr::vector<std::string_view> plus_words;
+        std::pmr::vector<std::string_view> minus_words;
+        // Документ должен содержать все фразы и ни одной минус-фразы.
+        // Слова фраз также входят в plus_words и учитываются в релевантности.
+        std::vector<Phrase> phrases;
+        std::vector<Phrase> minus_phrases;
+    };
 
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy& policy,const Query& query, DocumentPredicate document_predicate) const;
+    // При позиционном индексе фраза — слова в кавычках: "curly cat" или -"curly cat", с допуском "curly cat"~2
+    Query ParseQuery(std::string_view text, bool skip_sort = false,
+                     std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+    Phrase ParsePhrase(const std::vector<std::string_view>& words, std::string_view slop) const;
+
+    bool ContainsPhrase(const Phrase& phrase, int document_id) const;
+    bool MatchesPhrases(const Query& query, int document_id) const;
+    // Отсортированные id документов со всеми фразами запроса: пересечение списков документов
+    // слов фраз с проверкой позиций. Пусто, если фраз в запросе нет.
+    std::optional<std::pmr::vector<int>> FindPhraseDocuments(const Query& query, std::pmr::memory_resource* resource) const;
+    template <typename DocumentToRelevance>
+    void ExcludeMinusPhrases(const Query& query, DocumentToRelevance& document_to_relevance) const;
+    // Отсортированные id документов с рейтингом из диапазона или nullopt, если их больше max_count
+    std::optional<std::pmr::vector<int>> FindRatingDocuments(const RatingRange& ratings, size_t max_count,
+                                                             std::pmr::memory_resource* resource) const;
+    // Документы, которыми ограничен обход списков слов запроса: документы с фразами запроса,
+    // иначе документы из диапазона рейтинга, если хотя бы для одного слова их поиск в списке
+    // дешевле обхода списка. nullopt — обходить списки целиком.
+    std::optional<std::pmr::vector<int>> FindCandidateDocuments(const Query& query, const std::optional<RatingRange>& ratings,
+                                                                std::pmr::memory_resource* resource) const;
+
+    // Наибольшее число кандидатов, поиск которых в дереве списка дешевле полного обхода списка
+    static size_t GetMaxLookupCount(size_t posting_count);
+    // Вызывает action(document_id, term_freq) для документов списка, входящих в candidates
+    template <typename ExecutionPolicy, typename Action>
+    static void ForEachCandidatePosting(const ExecutionPolicy& policy, const DocumentFrequencies& postings,
+                                        const std::optional<std::pmr::vector<int>>& candidates, Action action);
+
+    ScoringContext GetScoringContext() const;
+
+    const ExecutionPlanner& GetExecutionPlanner() const;
+    // Работа запроса — суммарная длина списков его слов, наибольшая часть — самый длинный список
+    ExecutionPlan PlanQuery(const Query& query) const;
+
+    // Запрос должен быть отсортирован
+    MatchDocumentResult MatchParsedQuery(const Query& query, int document_id) const;
+    template <typename ExecutionPolicy>
+    std::vector<MatchDocumentResult> MatchDocumentsImpl(const ExecutionPolicy& policy, std::string_view raw_query, const std::vector<int>& document_ids) const;
+
+    // Первые limit документов, ранжированных после курсора, в порядке выдачи
+    template <typename Scoring, typename DocumentPredicate, typename ExecutionPolicy>
+    std::vector<Document> FindRankedDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                              const std::optional<RatingRange>& ratings,
+                                              const std::optional<SearchCursor>& after, size_t limit) const;
+
+    // Релевантности, отличающиеся меньше чем на RELEVANCE_EPSILON, считаются равными
+    static constexpr double RELEVANCE_EPSILON = 1e-6;
+    static bool IsRankedBefore(const Document& lhs, const Document& rhs);
+    // Отбор через кучу размера limit вместо сортировки всех найденных документов.
+    // Результат записывается в top_documents, чтобы переиспользовать его ёмкость.
+    static std::vector<Document> SelectTopDocuments(const std::pmr::vector<Document>& documents,
+                                                    const std::optional<SearchCursor>& after, size_t limit,
+                                                    std::vector<Document> top_documents = {});
+
+    static bool IsSingleWordQuery(const Query& query);
+    // Первые limit документов по списку слова, упорядоченному по term_freq
+    template <typename Scoring, typename DocumentPredicate>
+    std::vector<Document> FindImpactOrderedDocuments(QueryExecution execution, std::string_view word, DocumentPredicate document_predicate,
+                                                     const std::optional<SearchCursor>& after, size_t limit,
+                                                     QueryContext::Lease& lease) const;
+
+    template <typename Scoring, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate,
+                                                const std::optional<RatingRange>& ratings, QueryContext::Lease& lease) const;
+
+    template <typename Scoring, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const std::execution::sequenced_policy& policy, const Query& query, DocumentPredicate document_predicate,
+                                                const std::optional<RatingRange>& ratings, QueryContext::Lease& lease) const;
+
+    template <typename Scoring, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const std::execution::parallel_policy& policy,const Query& query, DocumentPredicate document_predicate,
+                                                const std::optional<RatingRange>& ratings, QueryContext::Lease& lease) const;
+
+    // Исполнение, выбранное для adaptive_policy
+    template <typename Scoring, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const ExecutionPlan& plan, const Query& query, DocumentPredicate document_predicate,
+                                                const std::optional<RatingRange>& ratings, QueryContext::Lease& lease) const;
 };
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
-{
-    if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
-        using namespace std::literals::string_literals;
-        throw std::invalid_argument("Some of stop words are invalid"s);
-    }
+SearchServer::SearchServer(const StringContainer& stop_words, const SearchServerOptions& options)
+    : memory_counters_(std::make_unique<MemoryCounters>())
+    , options_(options)
+    , query_kept_punctuation_(MakeQueryKeptPunctuation(options))
+    , stop_words_(MakeStopWords(MakeUniqueNonEmptyStrings(stop_words), memory_counters_->stop_words, options.normalize_text))
+    , word_to_document_freqs_(MakeNestedAllocator<WordPostings>(memory_counters_->dictionary, memory_counters_->postings, options.memory_resource))
+    , document_to_word_freqs_(MakeNestedAllocator<DocumentToWordFrequencies>(memory_counters_->document_words, memory_counters_->document_words,
+                                                                             options.memory_resource))
+    , documents_(Documents::allocator_type(&memory_counters_->documents, options.memory_resource))
+    , document_ids_(DocumentIds::allocator_type(&memory_counters_->document_ids, options.memory_resource))
+    , rating_index_(RatingIndex::allocator_type(&memory_counters_->rating_index, options.memory_resource))
+    , document_to_word_positions_(DocumentToWordPositions::allocator_type(
+          DocumentToWordPositions::allocator_type::outer_allocator_type(&memory_counters_->positions, options.memory_resource),
+          MakeNestedAllocator<WordPositions>(memory_counters_->positions, memory_counters_->positions, options.memory_resource)))
+    , word_impacts_(MakeNestedAllocator<WordImpacts>(memory_counters_->impact_postings, memory_counters_->impact_postings, options.memory_resource))
+    , term_dictionaries_(&memory_counters_->term_dictionary)
+    , query_latency_stats_(std::make_unique<QueryLatencyStats>()) {
 }
 
-template <typename ExecutionPolicy>
+template <typename Scoring>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments<Scoring>(std::execution::seq, raw_query, status);
+}
+
+template <typename Scoring>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments<Scoring>(std::execution::seq, raw_query);
+}
+
+template <typename Scoring, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const{
-    return FindTopDocuments(policy, raw_query, [status](int, DocumentStatus document_status, int ) {
+    return FindTopDocuments<Scoring>(policy, raw_query, [status](int, DocumentStatus document_status, int ) {
         return document_status == status;
     });
 }
 
-template <typename ExecutionPolicy>
+template <typename Scoring, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const{
-    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+    return FindTopDocuments<Scoring>(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
 
-template <typename DocumentPredicate>
+template <typename Scoring, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
-    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+    return FindTopDocuments<Scoring>(std::execution::seq, raw_query, document_predicate);
 }
 
-template <typename DocumentPredicate, typename ExecutionPolicy>
+template <typename Scoring, typename DocumentPredicate, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate) const{
-    const auto query = ParseQuery(raw_query);
+    constexpr auto execution = QueryLatencyStats::GetExecution<ExecutionPolicy>();
+    TRACE_SCOPE(execution == QueryExecution::PARALLEL ? "FindTopDocuments(par)" : "FindTopDocuments");
+    return FindRankedDocuments<Scoring>(policy, raw_query, document_predicate, std::nullopt, std::nullopt, MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template <typename Scoring>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const RatingRange& ratings, DocumentStatus status) const {
+    return FindTopDocuments<Scoring>(std::execution::seq, raw_query, ratings, status);
+}
 
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+template <typename Scoring, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, const RatingRange& ratings,
+                                                     DocumentStatus status) const {
+    constexpr auto execution = QueryLatencyStats::GetExecution<ExecutionPolicy>();
+    TRACE_SCOPE(execution == QueryExecution::PARALLEL ? "FindTopDocuments(par)" : "FindTopDocuments");
+    const auto document_predicate = [status, ratings](int, DocumentStatus document_status, int rating) {
+        return document_status == status && ratings.Contains(rating);
+    };
+    return FindRankedDocuments<Scoring>(policy, raw_query, document_predicate, ratings, std::nullopt, MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template <typename Scoring>
+SearchPage SearchServer::FindDocumentsPage(std::string_view raw_query, DocumentStatus status, const PageRequest& request) const {
+    return FindDocumentsPage<Scoring>(std::execution::seq, raw_query, status, request);
+}
+
+template <typename Scoring>
+SearchPage SearchServer::FindDocumentsPage(std::string_view raw_query, const PageRequest& request) const {
+    return FindDocumentsPage<Scoring>(std::execution::seq, raw_query, request);
+}
 
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        double eps = 1e-6;
-        if (std::abs(lhs.relevance - rhs.relevance) < eps) {
-            return lhs.rating > rhs.rating;
+template <typename Scoring, typename ExecutionPolicy>
+SearchPage SearchServer::FindDocumentsPage(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status, const PageRequest& request) const {
+    return FindDocumentsPage<Scoring>(policy, raw_query, [status](int, DocumentStatus document_status, int) {
+        return document_status == status;
+    }, request);
+}
+
+template <typename Scoring, typename ExecutionPolicy>
+SearchPage SearchServer::FindDocumentsPage(const ExecutionPolicy& policy, std::string_view raw_query, const PageRequest& request) const {
+    return FindDocumentsPage<Scoring>(policy, raw_query, DocumentStatus::ACTUAL, request);
+}
+
+template <typename Scoring, typename DocumentPredicate>
+SearchPage SearchServer::FindDocumentsPage(std::string_view raw_query, DocumentPredicate document_predicate, const PageRequest& request) const {
+    return FindDocumentsPage<Scoring>(std::execution::seq, raw_query, document_predicate, request);
+}
+
+template <typename Scoring, typename DocumentPredicate, typename ExecutionPolicy>
+SearchPage SearchServer::FindDocumentsPage(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate, const PageRequest& request) const {
+    using namespace std::literals::string_literals;
+    TRACE_SCOPE("FindDocumentsPage");
+    if (request.page_size == 0) {
+        throw std::invalid_argument("Page size must be positive"s);
+    }
+    // Лишний документ показывает, есть ли следующая страница. Сумма ограничена, чтобы не переполниться
+    // при page_size и offset, близких к SIZE_MAX.
+    const size_t max_limit = std::numeric_limits<size_t>::max();
+    const size_t page_size = std::min(request.page_size, max_limit - 1);
+    const size_t limit = std::min(request.offset, max_limit - page_size - 1) + page_size + 1;
+    auto ranked_documents = FindRankedDocuments<Scoring>(policy, raw_query, document_predicate, std::nullopt, request.after, limit);
+
+    SearchPage page;
+    if (ranked_documents.size() > request.offset) {
+        const auto page_begin = ranked_documents.begin() + request.offset;
+        page.documents.assign(page_begin, page_begin + std::min(request.page_size, ranked_documents.size() - request.offset));
+    }
+    if (ranked_documents.size() == limit) {
+        const Document& last = page.documents.back();
+        page.next_cursor = SearchCursor{last.relevance, last.rating, last.id};
+    }
+    return page;
+}
+
+template <typename Scoring, typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindRankedDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                        const std::optional<RatingRange>& ratings,
+                                                        const std::optional<SearchCursor>& after, size_t limit) const {
+    constexpr bool is_adaptive = std::is_same_v<ExecutionPolicy, AdaptivePolicy>;
+    const auto parse_start = QueryLatencyStats::Clock::now();
+    // Временные данные запроса освобождаются все сразу при выходе
+    QueryContext::Lease lease(QueryContext::GetCurrent());
+    const auto query = ParseQuery(raw_query, false, lease.GetResource());
+
+    bool is_impact_ordered = false;
+    if constexpr (Scoring::IS_MONOTONE_IN_TERM_FREQ) {
+        // Узкий диапазон рейтинга выгоднее обработать через индекс рейтинга
+        is_impact_ordered = options_.impact_ordered_postings && !ratings && IsSingleWordQuery(query);
+    }
+    // При adaptive_policy все этапы записываются под исполнением, которое выбрал планировщик
+    ExecutionPlan plan;
+    QueryExecution execution = QueryLatencyStats::GetExecution<ExecutionPolicy>();
+    if constexpr (is_adaptive) {
+        if (!is_impact_ordered) {
+            plan = PlanQuery(query);
+            execution = plan.IsParallel() ? QueryExecution::PARALLEL : QueryExecution::SEQUENTIAL;
+        }
+    }
+    query_latency_stats_->Record(execution, QueryStage::PARSE, parse_start);
+
+    if constexpr (Scoring::IS_MONOTONE_IN_TERM_FREQ) {
+        if (is_impact_ordered) {
+            return FindImpactOrderedDocuments<Scoring>(execution, query.plus_words.front(), document_predicate, after, limit, lease);
+        }
+    }
+
+    const auto matched_documents = [&] {
+        if constexpr (is_adaptive) {
+            return FindAllDocuments<Scoring>(plan, query, document_predicate, ratings, lease);
         } else {
-            return lhs.relevance > rhs.relevance;
+            return FindAllDocuments<Scoring>(policy, query, document_predicate, ratings, lease);
+        }
+    }();
+
+    const auto sort_start = QueryLatencyStats::Clock::now();
+    auto ranked_documents = SelectTopDocuments(matched_documents, after, limit, lease.TakeResults());
+    query_latency_stats_->Record(execution, QueryStage::SORT, sort_start);
+
+    return ranked_documents;
+}
+
+
+template <typename Scoring, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindImpactOrderedDocuments(QueryExecution execution, std::string_view word, DocumentPredicate document_predicate,
+                                                               const std::optional<SearchCursor>& after, size_t limit,
+                                                               QueryContext::Lease& lease) const {
+    auto stage_start = QueryLatencyStats::Clock::now();
+    std::pmr::vector<Document> matched_documents(lease.GetResource());
+    const auto impacts = word_impacts_.find(word);
+    if (impacts != word_impacts_.end() && limit > 0) {
+        const ScoringContext scoring_context = GetScoringContext();
+        const double word_weight = Scoring::ComputeWordWeight(scoring_context, impacts->second.size());
+        // Релевантность limit-го подходящего документа. Документы, релевантность которых меньше
+        // хотя бы на RELEVANCE_EPSILON, ранжируются после него, и обход можно прекратить.
+        double threshold = 0.0;
+        for (const ImpactPosting& posting : impacts->second) {
+            const auto& document_data = documents_.at(posting.document_id);
+            const double relevance = Scoring::Accumulate(0.0, Scoring::ComputeScore(scoring_context, word_weight, posting.term_freq, document_data.word_count));
+            if (matched_documents.size() >= limit && threshold - relevance >= RELEVANCE_EPSILON) {
+                break;
+            }
+            if (!document_predicate(posting.document_id, document_data.status, document_data.rating)) {
+                continue;
+            }
+            const Document document{posting.document_id, relevance, document_data.rating};
+            if (after && !IsRankedBefore(Document{after->id, after->relevance, after->rating}, document)) {
+                continue;
+            }
+            matched_documents.push_back(document);
+            if (matched_documents.size() == limit) {
+                threshold = relevance;
+            }
         }
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
     }
+    stage_start = query_latency_stats_->Record(execution, QueryStage::POSTINGS_SCAN, stage_start);
+
+    auto ranked_documents = SelectTopDocuments(matched_documents, std::nullopt, limit, lease.TakeResults());
+    query_latency_stats_->Record(execution, QueryStage::SORT, stage_start);
+    return ranked_documents;
+}
+
+template <typename Scoring, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate,
+                                                          const std::optional<RatingRange>& ratings, QueryContext::Lease& lease) const {
+    return FindAllDocuments<Scoring>(std::execution::seq, query, document_predicate, ratings, lease);
+}
 
+template <typename Scoring, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const ExecutionPlan& plan, const Query& query, DocumentPredicate document_predicate,
+                                                          const std::optional<RatingRange>& ratings, QueryContext::Lease& lease) const {
+    if (!plan.IsParallel()) {
+        return FindAllDocuments<Scoring>(std::execution::seq, query, document_predicate, ratings, lease);
+    }
+    std::pmr::vector<Document> matched_documents(lease.GetResource());
+    ExecutionPlanner::Execute(plan, [&] {
+        matched_documents = FindAllDocuments<Scoring>(std::execution::par, query, document_predicate, ratings, lease);
+    });
     return matched_documents;
 }
 
+template <typename DocumentToRelevance>
+void SearchServer::ExcludeMinusPhrases(const Query& query, DocumentToRelevance& document_to_relevance) const {
+    if (query.minus_phrases.empty()) {
+        return;
+    }
+    for (auto it = document_to_relevance.begin(); it != document_to_relevance.end();) {
+        const int document_id = it->first;
+        const bool has_minus_phrase = std::any_of(query.minus_phrases.begin(), query.minus_phrases.end(), [this, document_id](const Phrase& phrase) {
+            return ContainsPhrase(phrase, document_id);
+        });
+        it = has_minus_phrase ? document_to_relevance.erase(it) : std::next(it);
+    }
+}
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    return FindAllDocuments(std::execution::seq, query, document_predicate);
+template <typename ExecutionPolicy, typename Action>
+void SearchServer::ForEachCandidatePosting(const ExecutionPolicy& policy, const DocumentFrequencies& postings,
+                                           const std::optional<std::pmr::vector<int>>& candidates, Action action) {
+    if (!candidates) {
+        std::for_each(policy, postings.begin(), postings.end(), [&action](const auto& posting) {
+            action(posting.first, posting.second);
+        });
+    } else if (candidates->size() <= GetMaxLookupCount(postings.size())) {
+        std::for_each(policy, candidates->begin(), candidates->end(), [&action, &postings](int document_id) {
+            const auto posting = postings.find(document_id);
+            if (posting != postings.end()) {
+                action(document_id, posting->second);
+            }
+        });
+    } else {
+        std::for_each(policy, postings.begin(), postings.end(), [&action, &candidates](const auto& posting) {
+            if (std::binary_search(candidates->begin(), candidates->end(), posting.first)) {
+                action(posting.first, posting.second);
+            }
+        });
+    }
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, DocumentPredicate document_predicate) const{
-    std::map<int, double> document_to_relevance;
+template <typename Scoring, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy& policy, const Query& query, DocumentPredicate document_predicate,
+                                                          const std::optional<RatingRange>& ratings, QueryContext::Lease& lease) const{
+    constexpr auto execution = QueryExecution::SEQUENTIAL;
+    auto stage_start = QueryLatencyStats::Clock::now();
+    const auto candidates = FindCandidateDocuments(query, ratings, lease.GetResource());
+    const ScoringContext scoring_context = GetScoringContext();
+    std::pmr::map<int, double> document_to_relevance(lease.GetResource());
     for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings == word_to_document_freqs_.end()) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
-            }
-        }
+        const double word_weight = Scoring::ComputeWordWeight(scoring_context, postings->second.size());
+        ForEachCandidatePosting(policy, postings->second, candidates,
+            [this, &document_to_relevance, &document_predicate, &scoring_context, word_weight](int document_id, double term_freq) {
+                const auto& document_data = documents_.at(document_id);
+                if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                    double& relevance = document_to_relevance[document_id];
+                    relevance = Scoring::Accumulate(relevance, Scoring::ComputeScore(scoring_context, word_weight, term_freq, document_data.word_count));
+                }
+            });
     }
 
+    stage_start = query_latency_stats_->Record(execution, QueryStage::POSTINGS_SCAN, stage_start);
+
     for (std::string_view word : query.minus_words) {
         if (word_to_document_freqs_.count(word) == 0) {
             continue;
@@ -182,52 +793,72 @@ std::vector<Document> SearchServer::FindAllDocuments(const std::execution::seque
             document_to_relevance.erase(document_id);
         }
     }
+    ExcludeMinusPhrases(query, document_to_relevance);
+    stage_start = query_latency_stats_->Record(execution, QueryStage::MINUS_WORDS, stage_start);
 
-    std::vector<Document> matched_documents;
+    std::pmr::vector<Document> matched_documents(lease.GetResource());
+    matched_documents.reserve(document_to_relevance.size());
     for (const auto [document_id, relevance] : document_to_relevance) {
         matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
     }
+    query_latency_stats_->Record(execution, QueryStage::RESULT_BUILD, stage_start);
     return matched_documents;
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy,const Query& query, DocumentPredicate document_predicate) const{
+template <typename Scoring, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy,const Query& query, DocumentPredicate document_predicate,
+                                                          const std::optional<RatingRange>& ratings, QueryContext::Lease& lease) const{
     using namespace std;
-    ConcurrentMap<int, double> document_to_relevance_par(MAX_COUNTS);
+    TRACE_SCOPE("FindAllDocuments(par)");
+    constexpr auto execution = QueryExecution::PARALLEL;
+    auto stage_start = QueryLatencyStats::Clock::now();
+    ConcurrentMap<int, double>& document_to_relevance_par = lease.GetRelevanceMap();
+    const auto candidates = FindCandidateDocuments(query, ratings, lease.GetResource());
+    const ScoringContext scoring_context = GetScoringContext();
 
     std::for_each(policy, query.plus_words.begin(), query.plus_words.end(),
-        [this, &document_to_relevance_par, &document_predicate, &policy] (const std::string_view word) {
-            if (word_to_document_freqs_.count(word) > 0) {
-                const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                std::for_each(policy,
-                    word_to_document_freqs_.at(word).begin(), word_to_document_freqs_.at(word).end(),
-                    [this, &document_to_relevance_par, &document_predicate, &inverse_document_freq] (const auto& pair) {
-                        const auto& document_data = documents_.at(pair.first);
-                        if (document_predicate(pair.first, document_data.status, document_data.rating)) {
-                            document_to_relevance_par[pair.first].ref_to_value += pair.second * inverse_document_freq;
+        [this, &document_to_relevance_par, &document_predicate, &policy, &candidates, &scoring_context] (const std::string_view word) {
+            TRACE_SCOPE("FindAllDocuments(par): plus word");
+            const auto postings = word_to_document_freqs_.find(word);
+            if (postings != word_to_document_freqs_.end()) {
+                const double word_weight = Scoring::ComputeWordWeight(scoring_context, postings->second.size());
+                ForEachCandidatePosting(policy, postings->second, candidates,
+                    [this, &document_to_relevance_par, &document_predicate, &word_weight, &scoring_context] (int document_id, double term_freq) {
+                        const auto& document_data = documents_.at(document_id);
+                        if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                            const double score = Scoring::ComputeScore(scoring_context, word_weight, term_freq, document_data.word_count);
+                            auto access = document_to_relevance_par[document_id];
+                            access.ref_to_value = Scoring::Accumulate(access.ref_to_value, score);
                         }
                 });
             }
      });
 
-    map<int, double> document_to_relevance = document_to_relevance_par.BuildOrdinaryMap();
+    stage_start = query_latency_stats_->Record(execution, QueryStage::POSTINGS_SCAN, stage_start);
 
+    // Минус-слова удаляются из корзин под их мьютексами
     std::for_each(policy, query.minus_words.begin(), query.minus_words.end(),
-        [this, &document_to_relevance, &policy] (const std::string_view word) {
+        [this, &document_to_relevance_par, &policy] (const std::string_view word) {
+            TRACE_SCOPE("FindAllDocuments(par): minus word");
             if (word_to_document_freqs_.count(word) > 0) {
                 std::for_each(policy,
                     word_to_document_freqs_.at(word).begin(), word_to_document_freqs_.at(word).end(),
-                    [&document_to_relevance] (const auto& pair) {
-                        document_to_relevance.erase(pair.first);
+                    [&document_to_relevance_par] (const auto& pair) {
+                        document_to_relevance_par.Erase(pair.first);
                 });
              }
         });
+    std::pmr::map<int, double> document_to_relevance(lease.GetResource());
+    document_to_relevance_par.MergeInto(document_to_relevance);
+    ExcludeMinusPhrases(query, document_to_relevance);
+    stage_start = query_latency_stats_->Record(execution, QueryStage::MINUS_WORDS, stage_start);
 
-    vector<Document> matched_documents;
+    std::pmr::vector<Document> matched_documents(lease.GetResource());
     matched_documents.reserve(document_to_relevance.size());
     for (const auto& [document_id, relevance] : document_to_relevance) {
         matched_documents.push_back(Document{document_id, relevance, documents_.at(document_id).rating});
     }
+    query_latency_stats_->Record(execution, QueryStage::RESULT_BUILD, stage_start);
     return matched_documents;
 }
 
@@ -1,12 +1,26 @@
 #ifndef STRING_PROCESSING_H
 #define STRING_PROCESSING_H
 
+#include <memory_resource>
 #include <set>
 #include <string>
 #include <string_view>
 #include <vector>
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view text, std::pmr::memory_resource* resource);
+
+// Нормализация текста для индекса и запросов: проверяет UTF-8, приводит к нижнему регистру латиницу
+// (включая Latin-1) и кириллицу, заменяет пробелами знаки препинания ASCII, кроме kept_punctuation,
+// а также пробелы и знаки Latin-1 и блока General Punctuation (« » — … и т. п.).
+// Длина текста не меняется, поэтому слова нормализованного текста лежат по тем же смещениям.
+// Записывает text.size() байт в output, который может совпадать с text.data().
+// При некорректном UTF-8 выбрасывает std::invalid_argument.
+void NormalizeText(std::string_view text, char* output, std::string_view kept_punctuation = {});
+
+// Длина в байтах символа UTF-8, начинающегося с байта offset. Байт, который не начинает
+// полную последовательность UTF-8, считается отдельным символом.
+size_t GetCharacterLength(std::string_view text, size_t offset);
 
 using TransparentStringSet = std::set<std::string, std::less<>>;
 
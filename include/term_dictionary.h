@@ -0,0 +1,68 @@
+#ifndef TERM_DICTIONARY_H
+#define TERM_DICTIONARY_H
+
+#include "counting_allocator.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Отсортированный словарь термов с фронтальным кодированием: терм хранится как длина общего
+// префикса с предыдущим термом и оставшийся суффикс. Каждый BLOCK_SIZE-й терм записан целиком,
+// по таким термам выполняется двоичный поиск.
+class TermDictionary {
+public:
+    static const size_t BLOCK_SIZE = 16;
+
+    TermDictionary() = default;
+    explicit TermDictionary(MemoryCounter* counter);
+
+    // terms отсортированы по возрастанию и не повторяются
+    void Assign(const std::vector<std::string_view>& terms);
+
+    size_t GetTermCount() const;
+
+    // Последовательный обход термов по возрастанию
+    class Cursor {
+    public:
+        bool IsValid() const;
+        std::string_view GetTerm() const;
+        // Длина общего префикса текущего и предыдущего терма, после Seek — 0
+        size_t GetSharedPrefix() const;
+
+        void Next();
+        // Переходит к первому терму не меньше target
+        void Seek(std::string_view target);
+
+    private:
+        friend class TermDictionary;
+        explicit Cursor(const TermDictionary* dictionary);
+
+        const TermDictionary* dictionary_;
+        size_t index_ = 0;
+        size_t offset_ = 0;
+        std::string term_;
+        size_t shared_prefix_ = 0;
+
+        void Decode();
+    };
+
+    Cursor LowerBound(std::string_view target) const;
+
+    // Не больше limit термов по возрастанию, подходящих под шаблон:
+    // * — любая последовательность символов, ? — один символ
+    std::vector<std::string> FindByPattern(std::string_view pattern, size_t limit) const;
+
+private:
+    std::vector<uint8_t, CountingAllocator<uint8_t>> bytes_;
+    std::vector<size_t, CountingAllocator<size_t>> block_offsets_;
+    size_t term_count_ = 0;
+
+    std::string_view GetBlockHead(size_t block) const;
+};
+
+// Подходит ли word под шаблон с * и ?. ? соответствует одному символу UTF-8.
+bool MatchesPattern(std::string_view word, std::string_view pattern);
+
+#endif // TERM_DICTIONARY_H
@@ -34,6 +34,49 @@ void TestSplitIntoWords();
 
 void TestRemoveDocuments();
 
+void TestAddDocuments();
+
+void TestWriteAheadLog();
+
+void TestIngestDocuments();
+
+void TestAsyncSearchServer();
+
+void TestDuplicateDetector();
+
+void TestMatchDocuments();
+
+void TestConcurrentRequestQueue();
+
+void TestLatencyHistogram();
+
+void TestQueryLatencyStats();
+
+void TestTrace();
+
+void TestPerfCounters();
+
+void TestTextGenerator();
+
+void TestLoadTester();
+void TestMemoryStats();
+void TestFindDocumentsPage();
+void TestPhraseQueries();
+void TestTermDictionary();
+void TestPerfectHashSet();
+void TestNormalizeText();
+void TestTextNormalization();
+void TestExecutionPlanner();
+void TestAdaptiveExecution();
+void TestWildcardQueries();
+void TestLevenshteinAutomaton();
+void TestFuzzyQueries();
+void TestScoringPolicies();
+void TestRatingRangeFilter();
+void TestImpactOrderedPostings();
+void TestMemoryResource();
+void TestQueryContext();
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer();
 
@@ -0,0 +1,90 @@
+#ifndef TEXT_GENERATOR_H
+#define TEXT_GENERATOR_H
+
+#include "document.h"
+
+#include <array>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Генераторы случайных слов, документов и запросов для бенчмарков
+std::string GenerateWord(std::mt19937& generator, int max_length);
+
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length);
+
+std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int word_count, double minus_prob = 0);
+
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary, int query_count, int max_word_count);
+
+// Распределение Ципфа на [0, n): вероятность k пропорциональна 1 / (k + 1)^exponent.
+// Выборка — двоичный поиск по заранее вычисленной функции распределения.
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t n, double exponent);
+
+    size_t operator()(std::mt19937& generator) const;
+
+private:
+    std::vector<double> cdf_;
+};
+
+struct CorpusOptions {
+    size_t document_count = 10'000;
+    size_t vocabulary_size = 50'000;
+    // Частота слова с рангом k пропорциональна 1 / k^zipf_exponent
+    double zipf_exponent = 1.0;
+    int max_word_length = 10;
+    // Длина документа в словах распределена логнормально
+    double mean_document_length = 70.0;
+    double document_length_sigma = 0.5;
+    // Доли статусов ACTUAL, IRRELEVANT, BANNED, REMOVED
+    std::array<double, 4> status_weights = {0.85, 0.05, 0.05, 0.05};
+    int max_rating_count = 5;
+    unsigned seed = 5489;
+};
+
+struct GeneratedDocument {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string text;
+};
+
+struct GeneratedCorpus {
+    // Слова упорядочены по убыванию частоты
+    std::vector<std::string> vocabulary;
+    std::vector<GeneratedDocument> documents;
+
+    // Записи ссылаются на тексты корпуса и действительны, пока он не изменён
+    std::vector<DocumentRecord> GetRecords() const;
+};
+
+GeneratedCorpus GenerateZipfCorpus(const CorpusOptions& options);
+
+struct QueryLogOptions {
+    size_t query_count = 1'000;
+    // Число различных запросов; их популярность тоже распределена по Ципфу:
+    // немногие частые запросы и длинный хвост редких
+    size_t distinct_query_count = 10'000;
+    double query_popularity_exponent = 1.1;
+    // Распределение слов запроса по словарю
+    double word_zipf_exponent = 1.0;
+    double mean_query_length = 3.0;
+    int min_query_length = 1;
+    int max_query_length = 16;
+    // Вероятность того, что слово запроса (кроме первого) станет минус-словом
+    double minus_word_rate = 0.1;
+    unsigned seed = 5490;
+};
+
+std::vector<std::string> GenerateQueryLog(const std::vector<std::string>& vocabulary, const QueryLogOptions& options);
+
+// Формат TSV, который читает IngestDocuments
+void WriteCorpus(std::ostream& output, const GeneratedCorpus& corpus);
+
+// Один запрос в строке
+void WriteQueryLog(std::ostream& output, const std::vector<std::string>& queries);
+
+#endif // TEXT_GENERATOR_H
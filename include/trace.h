@@ -0,0 +1,55 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "log_duration.h"
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+#define TRACE_SCOPE(name) TraceScope UNIQUE_VAR_NAME_PROFILE(name)
+
+// Трассировка выполнения в формате Chrome trace_event (chrome://tracing, Perfetto).
+// Каждый поток пишет события в собственный кольцевой буфер без блокировок и без ввода-вывода;
+// при переполнении буфера перезаписываются самые старые события потока.
+// Пока трассировка выключена, TRACE_SCOPE стоит одного чтения атомарного флага.
+// WriteChromeTrace и ClearTrace следует вызывать после DisableTracing,
+// когда потоки уже не пишут события.
+void EnableTracing();
+void DisableTracing();
+bool IsTracingEnabled();
+
+// Имя должно жить до выгрузки трассировки — обычно это строковый литерал
+void RecordTraceEvent(const char* name, std::chrono::steady_clock::time_point begin,
+                      std::chrono::steady_clock::time_point end);
+
+void WriteChromeTrace(std::ostream& output);
+void ClearTrace();
+size_t GetTraceEventCount();
+
+class TraceScope {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TraceScope(const char* name)
+        : name_(IsTracingEnabled() ? name : nullptr) {
+        if (name_ != nullptr) {
+            start_time_ = Clock::now();
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    ~TraceScope() {
+        if (name_ != nullptr) {
+            RecordTraceEvent(name_, start_time_, Clock::now());
+        }
+    }
+
+private:
+    const char* const name_;
+    Clock::time_point start_time_;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,55 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include "document.h"
+#include "search_server.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Журнал изменений (write-ahead log) для AddDocument и RemoveDocument.
+// Записи накапливаются в буфере и сбрасываются на диск группой: одним write и одним fsync
+// после каждых batch_size записей либо при явном вызове Sync().
+// Изменения, попавшие в журнал до последнего Sync(), переживают падение процесса.
+class WriteAheadLog {
+public:
+    static const size_t DEFAULT_BATCH_SIZE = 256;
+
+    WriteAheadLog(SearchServer& search_server, const std::string& path, size_t batch_size = DEFAULT_BATCH_SIZE);
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Изменение сначала применяется к серверу, и только успешное попадает в журнал,
+    // поэтому при воспроизведении все записи заведомо корректны
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    void Sync();
+    size_t GetPendingCount() const;
+
+    // Воспроизводит журнал поверх текущего состояния сервера (например, загруженного снимка).
+    // Добавления, отменённые последующим удалением, отбрасываются, остальные
+    // применяются одним пакетом через AddDocuments. Оборванная запись в конце
+    // журнала (недописанная группа) игнорируется. Возвращает число прочитанных записей.
+    static size_t Replay(const std::string& path, SearchServer& search_server);
+
+private:
+    enum class RecordType : uint8_t {
+        ADD_DOCUMENT = 1,
+        REMOVE_DOCUMENT = 2,
+    };
+
+    SearchServer& search_server_;
+    int fd_;
+    const size_t batch_size_;
+    size_t pending_count_ = 0;
+    std::string buffer_;
+
+    void AppendRecord(const std::string& payload);
+};
+
+#endif // WRITE_AHEAD_LOG_H
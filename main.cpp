@@ -5,49 +5,17 @@
 #include "./include/log_duration.h"
 #include "./include/test_example_functions.h"
 #include "./include/process_queries.h"
+#include "./include/document_ingestion.h"
+#include "./include/duplicate_detector.h"
+#include "./include/text_generator.h"
+#include "./include/write_ahead_log.h"
 
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <random>
 
 using namespace std;
-string GenerateWord(mt19937& generator, int max_length) {
-    const int length = uniform_int_distribution(1, max_length)(generator);
-    string word;
-    word.reserve(length);
-    for (int i = 0; i < length; ++i) {
-        word.push_back(uniform_int_distribution('a', 'z')(generator));
-    }
-    return word;
-}
-vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
-    vector<string> words;
-    words.reserve(word_count);
-    for (int i = 0; i < word_count; ++i) {
-        words.push_back(GenerateWord(generator, max_length));
-    }
-    words.erase(unique(words.begin(), words.end()), words.end());
-    return words;
-}
-string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0) {
-    string query;
-    for (int i = 0; i < word_count; ++i) {
-        if (!query.empty()) {
-            query.push_back(' ');
-        }
-        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
-            query.push_back('-');
-        }
-        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
-    }
-    return query;
-}
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
-    vector<string> queries;
-    queries.reserve(query_count);
-    for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
-    }
-    return queries;
-}
 template <typename ExecutionPolicy>
 void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
     LOG_DURATION(mark);
@@ -60,6 +28,57 @@ void Test(string_view mark, const SearchServer& search_server, const vector<stri
     cout << total_relevance << endl;
 }
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
+
+void TestIngestion(const vector<string>& documents) {
+    const string path = (filesystem::temp_directory_path() / "search_server_bench.wal"s).string();
+    remove(path.c_str());
+    {
+        SearchServer search_server(""s);
+        LOG_DURATION("ingestion without WAL"s);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+    {
+        SearchServer search_server(""s);
+        LOG_DURATION("ingestion with WAL"s);
+        WriteAheadLog wal(search_server, path);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            wal.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+    {
+        SearchServer search_server(""s);
+        LOG_DURATION("WAL replay"s);
+        WriteAheadLog::Replay(path, search_server);
+    }
+    {
+        ofstream corpus(path);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            corpus << i << "\tACTUAL\t1 2 3\t"s << documents[i] << '\n';
+        }
+    }
+    {
+        SearchServer search_server(""s);
+        LOG_DURATION("file ingestion"s);
+        const auto stats = IngestDocuments(search_server, path);
+        cout << "file ingestion: "s << stats.GetMegabytesPerSecond() << " MB/s"s << endl;
+    }
+    remove(path.c_str());
+}
+void TestDuplicateSearch(const SearchServer& search_server) {
+    {
+        LOG_DURATION("exact duplicates"s);
+        DuplicateDetector detector;
+        cout << detector.FindDuplicates(execution::par, search_server).size() << endl;
+    }
+    {
+        LOG_DURATION("near duplicates"s);
+        DuplicateDetector detector(0.8);
+        cout << detector.FindDuplicates(execution::par, search_server).size() << endl;
+    }
+}
+
 int main() {
     TestSearchServer();
 
@@ -73,4 +92,6 @@ int main() {
     const auto queries = GenerateQueries(generator, dictionary, 100, 70);
     TEST(seq);
     TEST(par);
+    TestIngestion(documents);
+    TestDuplicateSearch(search_server);
 }
@@ -0,0 +1,84 @@
+#include "../include/async_search_server.h"
+
+using namespace std;
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, size_t worker_count, size_t queue_capacity)
+    : search_server_(search_server)
+    , tasks_(queue_capacity) {
+    worker_count = max<size_t>(worker_count, 1);
+    workers_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back([this] {
+            RunWorker();
+        });
+    }
+}
+
+AsyncSearchServer::~AsyncSearchServer() {
+    tasks_.Close();
+    for (thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+future<AsyncSearchResult> AsyncSearchServer::FindTopDocumentsAsync(string raw_query, DocumentStatus status) {
+    return FindTopDocumentsAsync(move(raw_query), [status](int, DocumentStatus document_status, int) {
+        return document_status == status;
+    });
+}
+
+future<AsyncSearchResult> AsyncSearchServer::FindTopDocumentsAsync(string raw_query) {
+    return FindTopDocumentsAsync(move(raw_query), DocumentStatus::ACTUAL);
+}
+
+optional<future<AsyncSearchResult>> AsyncSearchServer::TryFindTopDocumentsAsync(string raw_query, DocumentStatus status) {
+    return TryFindTopDocumentsAsync(move(raw_query), [status](int, DocumentStatus document_status, int) {
+        return document_status == status;
+    });
+}
+
+optional<future<AsyncSearchResult>> AsyncSearchServer::TryFindTopDocumentsAsync(string raw_query) {
+    return TryFindTopDocumentsAsync(move(raw_query), DocumentStatus::ACTUAL);
+}
+
+size_t AsyncSearchServer::GetQueueSize() const {
+    return tasks_.GetSize();
+}
+
+size_t AsyncSearchServer::GetWorkerCount() const {
+    return workers_.size();
+}
+
+size_t AsyncSearchServer::GetRejectedCount() const {
+    return rejected_count_.load(memory_order_relaxed);
+}
+
+future<AsyncSearchResult> AsyncSearchServer::Submit(Task task) {
+    auto result = task.promise.get_future();
+    tasks_.Push(move(task));
+    return result;
+}
+
+optional<future<AsyncSearchResult>> AsyncSearchServer::TrySubmit(Task task) {
+    auto result = task.promise.get_future();
+    if (!tasks_.TryPush(task)) {
+        rejected_count_.fetch_add(1, memory_order_relaxed);
+        return nullopt;
+    }
+    return result;
+}
+
+void AsyncSearchServer::RunWorker() {
+    while (auto task = tasks_.Pop()) {
+        const auto start_time = Clock::now();
+        try {
+            AsyncSearchResult result;
+            result.documents = task->search();
+            result.queue_time = start_time - task->enqueue_time;
+            result.execution_time = Clock::now() - start_time;
+            task->promise.set_value(move(result));
+        } catch (...) {
+            task->promise.set_exception(current_exception());
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#include "../include/concurrent_request_queue.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+ConcurrentRequestQueue::ConcurrentRequestQueue(const SearchServer& search_server, Clock::duration window, size_t capacity)
+    : search_server_(search_server)
+    , window_(window)
+    , mask_(RoundUpToPowerOfTwo(max<size_t>(capacity, 1)) - 1)
+    , slots_(make_unique<Slot[]>(mask_ + 1)) {
+}
+
+vector<Document> ConcurrentRequestQueue::AddFindRequest(string_view raw_query) {
+    return AddFindRequest(execution::seq, raw_query);
+}
+
+void ConcurrentRequestQueue::RecordRequest(size_t result_count, Clock::duration latency, Clock::time_point finish_time) {
+    const uint64_t index = next_index_.fetch_add(1, memory_order_relaxed);
+    Slot& slot = slots_[index & mask_];
+    // Версия 2 * index + 1 помечает запись, 2 * index + 2 — опубликованные данные
+    slot.version.store(2 * index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot.finish_time.store(finish_time.time_since_epoch().count(), memory_order_relaxed);
+    slot.latency.store(latency.count(), memory_order_relaxed);
+    slot.result_count.store(static_cast<uint32_t>(result_count), memory_order_relaxed);
+    slot.version.store(2 * index + 2, memory_order_release);
+}
+
+ConcurrentRequestQueue::Statistics ConcurrentRequestQueue::GetStatistics(Clock::time_point now) const {
+    Statistics statistics;
+    vector<Clock::duration> latencies;
+    const auto window_start = (now - window_).time_since_epoch().count();
+    const auto window_end = now.time_since_epoch().count();
+
+    for (size_t i = 0; i <= mask_; ++i) {
+        const Slot& slot = slots_[i];
+        const uint64_t version = slot.version.load(memory_order_acquire);
+        if (version == 0 || version % 2 == 1) {
+            continue;
+        }
+        const auto finish_time = slot.finish_time.load(memory_order_relaxed);
+        const auto latency = slot.latency.load(memory_order_relaxed);
+        const auto result_count = slot.result_count.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.version.load(memory_order_relaxed) != version) {
+            continue;
+        }
+        if (finish_time <= window_start || finish_time > window_end) {
+            continue;
+        }
+
+        ++statistics.request_count;
+        if (result_count == 0) {
+            ++statistics.no_result_count;
+        }
+        ++statistics.result_size_counts[min<size_t>(result_count, MAX_RESULT_DOCUMENT_COUNT)];
+        latencies.push_back(Clock::duration(latency));
+    }
+
+    if (!latencies.empty()) {
+        const auto percentile = [&latencies](double fraction) {
+            const auto nth = latencies.begin() + static_cast<ptrdiff_t>(fraction * (latencies.size() - 1));
+            nth_element(latencies.begin(), nth, latencies.end());
+            return *nth;
+        };
+        statistics.latency_p50 = percentile(0.5);
+        statistics.latency_p90 = percentile(0.9);
+        statistics.latency_p99 = percentile(0.99);
+        statistics.latency_max = *max_element(latencies.begin(), latencies.end());
+    }
+    return statistics;
+}
+
+int ConcurrentRequestQueue::GetNoResultRequests() const {
+    return static_cast<int>(GetStatistics().no_result_count);
+}
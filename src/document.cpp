@@ -9,3 +9,17 @@ ostream& operator<<(ostream& out, const Document& document) {
         << "rating = "s << document.rating << " }"s;
     return out;
 }
+
+ostream& operator<<(ostream& out, DocumentStatus status) {
+    switch (status) {
+        case DocumentStatus::ACTUAL:
+            return out << "ACTUAL"s;
+        case DocumentStatus::IRRELEVANT:
+            return out << "IRRELEVANT"s;
+        case DocumentStatus::BANNED:
+            return out << "BANNED"s;
+        case DocumentStatus::REMOVED:
+            return out << "REMOVED"s;
+    }
+    return out << static_cast<int>(status);
+}
@@ -0,0 +1,386 @@
+#include "../include/document_ingestion.h"
+#include "../include/bounded_queue.h"
+
+#include <charconv>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile(const string& path) {
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw system_error(errno, generic_category(), "Can't open "s + path);
+    }
+    struct stat file_stat {};
+    if (::fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        void* data = ::mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            ::madvise(data, static_cast<size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(data);
+            size_ = static_cast<size_t>(file_stat.st_size);
+            is_mapped_ = true;
+        }
+    }
+    ::close(fd);
+    if (is_mapped_) {
+        return;
+    }
+#endif
+    ifstream input(path, ios::binary);
+    if (!input) {
+        throw invalid_argument("Can't open "s + path);
+    }
+    buffer_.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (is_mapped_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+string_view MappedFile::GetData() const {
+    return {data_, size_};
+}
+
+namespace {
+
+void SkipSpaces(string_view& text) {
+    text.remove_prefix(min(text.find_first_not_of(" \t\r"sv), text.size()));
+}
+
+int ParseInt(string_view& text) {
+    SkipSpaces(text);
+    int value = 0;
+    const auto [ptr, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc()) {
+        throw invalid_argument("Expected integer"s);
+    }
+    text.remove_prefix(static_cast<size_t>(ptr - text.data()));
+    return value;
+}
+
+string_view CutField(string_view& line) {
+    const size_t tab = line.find('\t');
+    if (tab == line.npos) {
+        throw invalid_argument("Expected 4 tab-separated fields"s);
+    }
+    const string_view field = line.substr(0, tab);
+    line.remove_prefix(tab + 1);
+    return field;
+}
+
+DocumentRecord ParseTsvRecord(string_view line) {
+    DocumentRecord record;
+    string_view id = CutField(line);
+    record.id = ParseInt(id);
+    record.status = ParseDocumentStatus(CutField(line));
+    string_view ratings = CutField(line);
+    for (SkipSpaces(ratings); !ratings.empty(); SkipSpaces(ratings)) {
+        record.ratings.push_back(ParseInt(ratings));
+    }
+    record.text = line;
+    return record;
+}
+
+void Expect(string_view& text, char c) {
+    SkipSpaces(text);
+    if (text.empty() || text.front() != c) {
+        throw invalid_argument("Expected '"s + c + "'"s);
+    }
+    text.remove_prefix(1);
+}
+
+void AppendUtf8(string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+uint32_t ParseHex4(string_view& text) {
+    uint32_t value = 0;
+    const auto [ptr, error] = from_chars(text.data(), text.data() + min<size_t>(4, text.size()), value, 16);
+    if (error != errc() || ptr != text.data() + 4) {
+        throw invalid_argument("Invalid \\u escape"s);
+    }
+    text.remove_prefix(4);
+    return value;
+}
+
+// Строка без escape-последовательностей возвращается как подстрока исходной
+string_view ParseJsonString(string_view& text, deque<string>& decoded_texts) {
+    Expect(text, '"');
+    const size_t end = text.find_first_of("\"\\"sv);
+    if (end == text.npos) {
+        throw invalid_argument("Unterminated string"s);
+    }
+    if (text[end] == '"') {
+        const string_view result = text.substr(0, end);
+        text.remove_prefix(end + 1);
+        return result;
+    }
+
+    string& decoded = decoded_texts.emplace_back(text.substr(0, end));
+    text.remove_prefix(end);
+    while (true) {
+        if (text.empty()) {
+            throw invalid_argument("Unterminated string"s);
+        }
+        const char c = text.front();
+        text.remove_prefix(1);
+        if (c == '"') {
+            return decoded;
+        }
+        if (c != '\\') {
+            decoded.push_back(c);
+            continue;
+        }
+        if (text.empty()) {
+            throw invalid_argument("Unterminated string"s);
+        }
+        const char escaped = text.front();
+        text.remove_prefix(1);
+        switch (escaped) {
+            case 'b': decoded.push_back('\b'); break;
+            case 'f': decoded.push_back('\f'); break;
+            case 'n': decoded.push_back('\n'); break;
+            case 'r': decoded.push_back('\r'); break;
+            case 't': decoded.push_back('\t'); break;
+            case 'u': {
+                uint32_t code_point = ParseHex4(text);
+                if (code_point >= 0xD800 && code_point < 0xDC00 && text.substr(0, 2) == "\\u"sv) {
+                    text.remove_prefix(2);
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (ParseHex4(text) - 0xDC00);
+                }
+                AppendUtf8(decoded, code_point);
+                break;
+            }
+            default: decoded.push_back(escaped);
+        }
+    }
+}
+
+void SkipJsonValue(string_view& text, deque<string>& decoded_texts) {
+    SkipSpaces(text);
+    if (!text.empty() && text.front() == '"') {
+        const size_t decoded_count = decoded_texts.size();
+        ParseJsonString(text, decoded_texts);
+        decoded_texts.resize(decoded_count);
+        return;
+    }
+    const size_t end = text.find_first_of(",}"sv);
+    if (text.substr(0, end).find_first_of("[{"sv) != string_view::npos) {
+        throw invalid_argument("Nested values are not supported"s);
+    }
+    text.remove_prefix(min(end, text.size()));
+}
+
+DocumentRecord ParseJsonRecord(string_view line, deque<string>& decoded_texts) {
+    DocumentRecord record;
+    Expect(line, '{');
+    SkipSpaces(line);
+    bool is_first = true;
+    while (!line.empty() && line.front() != '}') {
+        if (!is_first) {
+            Expect(line, ',');
+        }
+        is_first = false;
+        const string key(ParseJsonString(line, decoded_texts));
+        Expect(line, ':');
+        if (key == "id"sv) {
+            record.id = ParseInt(line);
+        } else if (key == "status"sv) {
+            SkipSpaces(line);
+            if (!line.empty() && line.front() == '"') {
+                record.status = ParseDocumentStatus(ParseJsonString(line, decoded_texts));
+            } else {
+                record.status = ParseDocumentStatus(line.substr(0, line.find_first_of(",} "sv)));
+                line.remove_prefix(min(line.find_first_of(",} "sv), line.size()));
+            }
+        } else if (key == "ratings"sv) {
+            Expect(line, '[');
+            SkipSpaces(line);
+            while (!line.empty() && line.front() != ']') {
+                if (!record.ratings.empty()) {
+                    Expect(line, ',');
+                }
+                record.ratings.push_back(ParseInt(line));
+                SkipSpaces(line);
+            }
+            Expect(line, ']');
+        } else if (key == "text"sv) {
+            record.text = ParseJsonString(line, decoded_texts);
+        } else {
+            SkipJsonValue(line, decoded_texts);
+        }
+        SkipSpaces(line);
+    }
+    Expect(line, '}');
+    return record;
+}
+
+DocumentFormat DetectFormat(string_view data) {
+    data.remove_prefix(min(data.find_first_not_of(" \t\r\n"sv), data.size()));
+    return !data.empty() && data.front() == '{' ? DocumentFormat::JSONL : DocumentFormat::TSV;
+}
+
+struct RecordBatch {
+    vector<DocumentRecord> documents;
+    // deque не перемещает элементы при перемещении самого контейнера,
+    // поэтому ссылки на раскодированные тексты остаются действительными
+    deque<string> decoded_texts;
+    SearchServer::DocumentsWords words;
+};
+
+} // namespace
+
+DocumentStatus ParseDocumentStatus(string_view text) {
+    static const pair<string_view, DocumentStatus> names[] = {
+        {"ACTUAL"sv, DocumentStatus::ACTUAL},
+        {"IRRELEVANT"sv, DocumentStatus::IRRELEVANT},
+        {"BANNED"sv, DocumentStatus::BANNED},
+        {"REMOVED"sv, DocumentStatus::REMOVED},
+    };
+    for (const auto& [name, status] : names) {
+        if (text == name) {
+            return status;
+        }
+    }
+    string_view rest = text;
+    const int value = ParseInt(rest);
+    if (!rest.empty() || value < 0 || value > static_cast<int>(DocumentStatus::REMOVED)) {
+        throw invalid_argument("Unknown document status "s + string(text));
+    }
+    return static_cast<DocumentStatus>(value);
+}
+
+DocumentRecord ParseDocumentRecord(string_view line, DocumentFormat format, deque<string>& decoded_texts) {
+    if (format == DocumentFormat::AUTO) {
+        format = DetectFormat(line);
+    }
+    return format == DocumentFormat::JSONL ? ParseJsonRecord(line, decoded_texts) : ParseTsvRecord(line);
+}
+
+double IngestionStats::GetMegabytesPerSecond() const {
+    return seconds > 0 ? static_cast<double>(byte_count) / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+IngestionStats IngestDocuments(SearchServer& search_server, const string& path, const IngestionOptions& options) {
+    const auto start_time = chrono::steady_clock::now();
+    const MappedFile file(path);
+    const string_view data = file.GetData();
+    const DocumentFormat format = options.format == DocumentFormat::AUTO ? DetectFormat(data) : options.format;
+    const size_t batch_size = max<size_t>(options.batch_size, 1);
+
+    BoundedQueue<RecordBatch> parsed(options.queue_capacity);
+    BoundedQueue<RecordBatch> tokenized(options.queue_capacity);
+    exception_ptr parse_error;
+    exception_ptr tokenize_error;
+
+    thread parser([&] {
+        try {
+            RecordBatch batch;
+            string_view rest = data;
+            size_t line_number = 0;
+            while (!rest.empty()) {
+                const size_t end = rest.find('\n');
+                string_view line = rest.substr(0, end);
+                rest.remove_prefix(end == rest.npos ? rest.size() : end + 1);
+                ++line_number;
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                if (line.find_first_not_of(" \t"sv) == line.npos) {
+                    continue;
+                }
+                try {
+                    batch.documents.push_back(ParseDocumentRecord(line, format, batch.decoded_texts));
+                } catch (const invalid_argument& e) {
+                    throw invalid_argument(path + ":"s + to_string(line_number) + ": "s + e.what());
+                }
+                if (batch.documents.size() >= batch_size) {
+                    if (!parsed.Push(move(batch))) {
+                        return;
+                    }
+                    batch = {};
+                }
+            }
+            if (!batch.documents.empty()) {
+                parsed.Push(move(batch));
+            }
+        } catch (...) {
+            parse_error = current_exception();
+            tokenized.Close();
+        }
+        parsed.Close();
+    });
+
+    thread tokenizer([&] {
+        try {
+            while (auto batch = parsed.Pop()) {
+                batch->words = search_server.TokenizeDocuments(execution::seq, batch->documents);
+                if (!tokenized.Push(move(*batch))) {
+                    break;
+                }
+            }
+        } catch (...) {
+            tokenize_error = current_exception();
+            parsed.Close();
+        }
+        tokenized.Close();
+    });
+
+    IngestionStats stats;
+    exception_ptr index_error;
+    try {
+        while (auto batch = tokenized.Pop()) {
+            search_server.AddDocuments(batch->documents, move(batch->words));
+            stats.document_count += batch->documents.size();
+        }
+    } catch (...) {
+        index_error = current_exception();
+        parsed.Close();
+        tokenized.Close();
+    }
+    parser.join();
+    tokenizer.join();
+
+    for (const exception_ptr& error : {parse_error, tokenize_error, index_error}) {
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+    stats.byte_count = data.size();
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    return stats;
+}
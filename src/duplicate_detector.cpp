@@ -0,0 +1,160 @@
+#include "../include/duplicate_detector.h"
+
+#include <optional>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// Коэффициенты независимых хеш-функций MinHash вида a * x + b
+struct MinHashCoefficients {
+    array<uint64_t, DocumentFingerprint::MINHASH_SIZE> a;
+    array<uint64_t, DocumentFingerprint::MINHASH_SIZE> b;
+
+    MinHashCoefficients() {
+        uint64_t state = 0x243F6A8885A308D3ull;
+        const auto next = [&state] {
+            // splitmix64
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        };
+        for (size_t i = 0; i < a.size(); ++i) {
+            a[i] = next() | 1;
+            b[i] = next();
+        }
+    }
+};
+
+const MinHashCoefficients MINHASH_COEFFICIENTS;
+
+} // namespace
+
+DuplicateDetector::DuplicateDetector(double similarity_threshold)
+    : similarity_threshold_(similarity_threshold) {
+    if (!(similarity_threshold > 0.0)) {
+        throw invalid_argument("Similarity threshold must be positive"s);
+    }
+}
+
+bool DuplicateDetector::IsNearDuplicateSearchEnabled() const {
+    return similarity_threshold_ < 1.0;
+}
+
+uint64_t DuplicateDetector::HashWord(string_view word) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : word) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t DuplicateDetector::Mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDull;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+void DuplicateDetector::AddWordToFingerprint(string_view word, DocumentFingerprint& fingerprint, bool with_minhash) {
+    const uint64_t hash = HashWord(word);
+    // Сумма хешей не зависит от порядка слов; слова документа уникальны
+    fingerprint.word_set_hash.first += Mix(hash);
+    fingerprint.word_set_hash.second += Mix(hash ^ 0x5851F42D4C957F2Dull);
+    if (!with_minhash) {
+        return;
+    }
+    for (size_t i = 0; i < DocumentFingerprint::MINHASH_SIZE; ++i) {
+        const auto value = static_cast<uint32_t>((MINHASH_COEFFICIENTS.a[i] * hash + MINHASH_COEFFICIENTS.b[i]) >> 32);
+        fingerprint.minhash[i] = min(fingerprint.minhash[i], value);
+    }
+}
+
+uint64_t DuplicateDetector::HashBand(const DocumentFingerprint& fingerprint, size_t band) {
+    uint64_t hash = band;
+    for (size_t i = band * ROWS_PER_BAND; i < (band + 1) * ROWS_PER_BAND; ++i) {
+        hash = Mix(hash ^ fingerprint.minhash[i]);
+    }
+    return hash;
+}
+
+double DuplicateDetector::EstimateSimilarity(const DocumentFingerprint& lhs, const DocumentFingerprint& rhs) {
+    size_t equal_count = 0;
+    for (size_t i = 0; i < DocumentFingerprint::MINHASH_SIZE; ++i) {
+        equal_count += lhs.minhash[i] == rhs.minhash[i];
+    }
+    return static_cast<double>(equal_count) / DocumentFingerprint::MINHASH_SIZE;
+}
+
+bool DuplicateDetector::CheckDocument(int document_id, const DocumentFingerprint& fingerprint, DuplicateMatch& match) {
+    match.document_id = document_id;
+    if (const auto it = exact_index_.find(fingerprint.word_set_hash); it != exact_index_.end()) {
+        match.original_id = it->second;
+        match.similarity = 1.0;
+        match.is_exact = true;
+        return true;
+    }
+
+    if (IsNearDuplicateSearchEnabled()) {
+        array<uint64_t, BAND_COUNT> band_hashes;
+        double best_similarity = 0.0;
+        optional<int> best_id;
+        for (size_t band = 0; band < BAND_COUNT; ++band) {
+            band_hashes[band] = HashBand(fingerprint, band);
+            const auto it = band_index_[band].find(band_hashes[band]);
+            if (it == band_index_[band].end()) {
+                continue;
+            }
+            for (const int candidate_id : it->second) {
+                const double similarity = EstimateSimilarity(fingerprint, fingerprints_.at(candidate_id));
+                if (!best_id || similarity > best_similarity || (similarity == best_similarity && candidate_id < *best_id)) {
+                    best_similarity = similarity;
+                    best_id = candidate_id;
+                }
+            }
+        }
+        if (best_id && best_similarity >= similarity_threshold_) {
+            match.original_id = *best_id;
+            match.similarity = best_similarity;
+            match.is_exact = false;
+            return true;
+        }
+        for (size_t band = 0; band < BAND_COUNT; ++band) {
+            band_index_[band][band_hashes[band]].push_back(document_id);
+        }
+    }
+
+    exact_index_.emplace(fingerprint.word_set_hash, document_id);
+    fingerprints_.emplace(document_id, fingerprint);
+    return false;
+}
+
+void DuplicateDetector::RemoveDocument(int document_id) {
+    const auto it = fingerprints_.find(document_id);
+    if (it == fingerprints_.end()) {
+        return;
+    }
+    const DocumentFingerprint& fingerprint = it->second;
+    exact_index_.erase(fingerprint.word_set_hash);
+    if (IsNearDuplicateSearchEnabled()) {
+        for (size_t band = 0; band < BAND_COUNT; ++band) {
+            const auto bucket = band_index_[band].find(HashBand(fingerprint, band));
+            auto& ids = bucket->second;
+            ids.erase(find(ids.begin(), ids.end(), document_id));
+            if (ids.empty()) {
+                band_index_[band].erase(bucket);
+            }
+        }
+    }
+    fingerprints_.erase(it);
+}
+
+size_t DuplicateDetector::GetDocumentCount() const {
+    return fingerprints_.size();
+}
@@ -0,0 +1,145 @@
+#include "../include/execution_planner.h"
+
+#include "../include/concurrent_map.h"
+#include "../include/query_context.h"
+
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <limits>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+#include <tbb/info.h>
+#include <tbb/task_arena.h>
+
+using namespace std;
+
+namespace {
+
+// Список документов модели: достаточно длинный, чтобы время на элемент не зависело от замера
+const int CALIBRATION_POSTING_COUNT = 4096;
+const int CALIBRATION_REPETITIONS = 5;
+const int DISPATCH_REPETITIONS = 20;
+
+// Наименьшее время function за repetitions повторений, setup перед каждым не учитывается
+template <typename Setup, typename Function>
+double MeasureMinNs(int repetitions, Setup setup, Function function) {
+    double best_ns = numeric_limits<double>::max();
+    for (int i = 0; i < repetitions; ++i) {
+        setup();
+        const auto start = chrono::steady_clock::now();
+        function();
+        best_ns = min(best_ns, chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+    }
+    return best_ns;
+}
+
+size_t GetMaxParallelism() {
+    return static_cast<size_t>(max(tbb::info::default_concurrency(), 1));
+}
+
+} // namespace
+
+ExecutionPlanner::ExecutionPlanner(const ExecutionCosts& costs)
+    : costs_(costs) {
+}
+
+const ExecutionPlanner& ExecutionPlanner::GetCalibrated() {
+    static const ExecutionPlanner planner(Calibrate());
+    return planner;
+}
+
+ExecutionCosts ExecutionPlanner::Calibrate() {
+    // Модель FindAllDocuments: обход списка слова с поиском данных документа
+    // и накоплением релевантности в дереве или в ConcurrentMap
+    map<int, double> postings;
+    map<int, int> documents;
+    for (int i = 0; i < CALIBRATION_POSTING_COUNT; ++i) {
+        postings.emplace(i * 3, 1.0 / (i + 1));
+        documents.emplace(i * 3, i);
+    }
+    // Результат сохраняется, чтобы компилятор не выбросил замеряемый код
+    volatile double checksum = 0.0;
+
+    ExecutionCosts costs;
+    vector<byte> buffer(CALIBRATION_POSTING_COUNT * 64);
+    optional<pmr::monotonic_buffer_resource> arena;
+    costs.sequential_item_ns = MeasureMinNs(CALIBRATION_REPETITIONS,
+        [&arena, &buffer] {
+            arena.emplace(buffer.data(), buffer.size());
+        },
+        [&arena, &postings, &documents, &checksum] {
+            pmr::map<int, double> relevance(&*arena);
+            for (const auto& [document_id, term_freq] : postings) {
+                if (documents.at(document_id) >= 0) {
+                    relevance[document_id] += term_freq;
+                }
+            }
+            checksum = checksum + relevance.size();
+        }) / CALIBRATION_POSTING_COUNT;
+
+    ConcurrentMap<int, double> concurrent_relevance(QueryContext::RELEVANCE_BUCKET_COUNT);
+    costs.parallel_item_ns = MeasureMinNs(CALIBRATION_REPETITIONS,
+        [&concurrent_relevance] {
+            concurrent_relevance.Clear();
+        },
+        [&concurrent_relevance, &postings, &documents] {
+            for (const auto& [document_id, term_freq] : postings) {
+                if (documents.at(document_id) >= 0) {
+                    concurrent_relevance[document_id].ref_to_value += term_freq;
+                }
+            }
+        }) / CALIBRATION_POSTING_COUNT;
+
+    costs.max_parallelism = GetMaxParallelism();
+    vector<double> tasks(costs.max_parallelism);
+    costs.parallel_dispatch_ns = MeasureMinNs(DISPATCH_REPETITIONS, [] {},
+        [&tasks] {
+            for_each(execution::par, tasks.begin(), tasks.end(), [](double& task) {
+                task += 1.0;
+            });
+        }) / costs.max_parallelism;
+    return costs;
+}
+
+ExecutionPlan ExecutionPlanner::Plan(size_t work, size_t max_task_work, size_t task_count) const {
+    ExecutionPlan best_plan;
+    double best_ns = costs_.sequential_item_ns * work;
+    const size_t max_parallelism = min(costs_.max_parallelism, task_count);
+    for (size_t parallelism = 2; parallelism <= max_parallelism; ++parallelism) {
+        const double thread_work = max(static_cast<double>(work) / parallelism, static_cast<double>(max_task_work));
+        const double ns = costs_.parallel_dispatch_ns * parallelism + costs_.parallel_item_ns * thread_work;
+        if (ns < best_ns) {
+            best_ns = ns;
+            best_plan.parallelism = parallelism;
+        }
+    }
+    return best_plan;
+}
+
+const ExecutionCosts& ExecutionPlanner::GetCosts() const {
+    return costs_;
+}
+
+void ExecutionPlanner::ExecuteImpl(size_t parallelism, void (*call)(void*), void* function) {
+    // Арена TBB ограничивает число потоков параллельных алгоритмов, запущенных внутри неё.
+    // Арены создаются при первом вызове, по одной на число потоков, и инициализируются при первом использовании.
+    static const vector<unique_ptr<tbb::task_arena>> arenas = [] {
+        vector<unique_ptr<tbb::task_arena>> arenas(GetMaxParallelism());
+        for (size_t parallelism = 2; parallelism < arenas.size(); ++parallelism) {
+            arenas[parallelism] = make_unique<tbb::task_arena>(static_cast<int>(parallelism));
+        }
+        return arenas;
+    }();
+    if (parallelism >= arenas.size() || !arenas[parallelism]) {
+        call(function);
+        return;
+    }
+    arenas[parallelism]->execute([call, function] {
+        call(function);
+    });
+}
@@ -0,0 +1,121 @@
+#include "../include/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+int FloorLog2(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int result = 0;
+    while (value >>= 1) {
+        ++result;
+    }
+    return result;
+#endif
+}
+
+} // namespace
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value);
+    }
+    const int exponent = FloorLog2(value);
+    const int shift = exponent - SUB_BUCKET_BITS;
+    const uint64_t mantissa = value >> shift;
+    return static_cast<size_t>((shift + 1) * SUB_BUCKET_COUNT + (mantissa - SUB_BUCKET_COUNT));
+}
+
+uint64_t LatencyHistogram::GetBucketValue(size_t index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const int shift = static_cast<int>(index / SUB_BUCKET_COUNT) - 1;
+    const uint64_t mantissa = SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT;
+    const uint64_t lower_bound = mantissa << shift;
+    return lower_bound + ((uint64_t{1} << shift) >> 1);
+}
+
+void LatencyHistogram::Record(chrono::nanoseconds latency) {
+    const uint64_t value = static_cast<uint64_t>(max<int64_t>(latency.count(), 0));
+    buckets_[GetBucketIndex(value)].fetch_add(1, memory_order_relaxed);
+    count_.fetch_add(1, memory_order_relaxed);
+    sum_.fetch_add(value, memory_order_relaxed);
+    uint64_t current_max = max_.load(memory_order_relaxed);
+    while (value > current_max && !max_.compare_exchange_weak(current_max, value, memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, memory_order_relaxed);
+    }
+    count_.store(0, memory_order_relaxed);
+    sum_.store(0, memory_order_relaxed);
+    max_.store(0, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_.load(memory_order_relaxed);
+}
+
+chrono::nanoseconds LatencyHistogram::GetPercentile(double fraction) const {
+    // Счётчики корзин копируются, чтобы перцентиль считался по согласованному срезу
+    vector<uint64_t> counts(BUCKET_COUNT);
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts[i] = buckets_[i].load(memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return chrono::nanoseconds(0);
+    }
+    const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(clamp(fraction, 0.0, 1.0) * total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            const uint64_t value = min(GetBucketValue(i), max_.load(memory_order_relaxed));
+            return chrono::nanoseconds(static_cast<int64_t>(value));
+        }
+    }
+    return chrono::nanoseconds(static_cast<int64_t>(max_.load(memory_order_relaxed)));
+}
+
+LatencySummary LatencyHistogram::GetSummary() const {
+    LatencySummary summary;
+    summary.count = GetCount();
+    if (summary.count == 0) {
+        return summary;
+    }
+    summary.mean = chrono::nanoseconds(static_cast<int64_t>(sum_.load(memory_order_relaxed) / summary.count));
+    summary.p50 = GetPercentile(0.5);
+    summary.p99 = GetPercentile(0.99);
+    summary.p999 = GetPercentile(0.999);
+    summary.max = chrono::nanoseconds(static_cast<int64_t>(max_.load(memory_order_relaxed)));
+    return summary;
+}
+
+QueryLatencySnapshot QueryLatencyStats::GetSnapshot() const {
+    QueryLatencySnapshot snapshot;
+    for (size_t execution = 0; execution < QUERY_EXECUTION_COUNT; ++execution) {
+        for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+            snapshot.stages[execution][stage] = histograms_[execution][stage].GetSummary();
+        }
+    }
+    return snapshot;
+}
+
+void QueryLatencyStats::Reset() {
+    for (auto& execution_histograms : histograms_) {
+        for (LatencyHistogram& histogram : execution_histograms) {
+            histogram.Reset();
+        }
+    }
+}
@@ -0,0 +1,174 @@
+#include "../include/levenshtein_automaton.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+string_view GetCharacter(string_view text, size_t offset) {
+    return text.substr(offset, GetCharacterLength(text, offset));
+}
+
+vector<string_view> SplitIntoCharacters(string_view text) {
+    vector<string_view> characters;
+    for (size_t offset = 0; offset < text.size(); offset += characters.back().size()) {
+        characters.push_back(GetCharacter(text, offset));
+    }
+    return characters;
+}
+
+} // namespace
+
+LevenshteinAutomaton::LevenshteinAutomaton(string_view word, int max_distance)
+    : max_distance_(static_cast<uint8_t>(max_distance)) {
+    if (max_distance < 0 || max_distance > 100) {
+        throw invalid_argument("Invalid edit distance "s + to_string(max_distance));
+    }
+    for (const string_view c : SplitIntoCharacters(word)) {
+        characters_.emplace_back(c);
+    }
+}
+
+LevenshteinAutomaton::State LevenshteinAutomaton::GetStartState() const {
+    State state(characters_.size() + 1);
+    for (size_t i = 0; i < state.size(); ++i) {
+        state[i] = static_cast<uint8_t>(min<size_t>(i, max_distance_ + 1));
+    }
+    return state;
+}
+
+void LevenshteinAutomaton::Step(const State& from, string_view c, State& to) const {
+    const uint8_t limit = max_distance_ + 1;
+    to.resize(from.size());
+    to[0] = min<uint8_t>(from[0] + 1, limit);
+    for (size_t i = 1; i < from.size(); ++i) {
+        const uint8_t replace = from[i - 1] + (characters_[i - 1] == c ? 0 : 1);
+        const uint8_t distance = min({replace, static_cast<uint8_t>(from[i] + 1), static_cast<uint8_t>(to[i - 1] + 1)});
+        to[i] = min(distance, limit);
+    }
+}
+
+bool LevenshteinAutomaton::IsMatch(const State& state) const {
+    return state.back() <= max_distance_;
+}
+
+bool LevenshteinAutomaton::CanMatch(const State& state) const {
+    return *min_element(state.begin(), state.end()) <= max_distance_;
+}
+
+int LevenshteinAutomaton::GetDistance(const State& state) const {
+    return state.back();
+}
+
+bool LevenshteinAutomaton::FindNextLiveChar(const State& state, string_view after, string& next) const {
+    // Пока есть запас по расстоянию, подходит любой символ: переходим за все строки, начинающиеся с after
+    if (*min_element(state.begin(), state.end()) < max_distance_) {
+        next.assign(after);
+        while (!next.empty() && static_cast<unsigned char>(next.back()) == 0xFF) {
+            next.pop_back();
+        }
+        if (next.empty()) {
+            return false;
+        }
+        next.back() = static_cast<char>(static_cast<unsigned char>(next.back()) + 1);
+        return true;
+    }
+    // Иначе только символ слова, продолжающий диагональ с расстоянием max_distance
+    const string* best = nullptr;
+    for (size_t i = 0; i < characters_.size(); ++i) {
+        if (state[i] == max_distance_ && characters_[i] > after && (!best || characters_[i] < *best)) {
+            best = &characters_[i];
+        }
+    }
+    if (!best) {
+        return false;
+    }
+    next = *best;
+    return true;
+}
+
+vector<FuzzyTerm> FindFuzzyTerms(const TermDictionary& dictionary, string_view word, int max_distance, size_t limit) {
+    const LevenshteinAutomaton automaton(word, max_distance);
+    // states[d] — состояние после первых d символов prefix, offsets[d] — их длина в байтах
+    vector<LevenshteinAutomaton::State> states{automaton.GetStartState()};
+    vector<size_t> offsets{0};
+    size_t depth = 0;
+    string prefix;
+    string next_char;
+    vector<FuzzyTerm> terms;
+
+    auto cursor = dictionary.LowerBound(""sv);
+    while (cursor.IsValid()) {
+        const string_view term = cursor.GetTerm();
+        const auto [prefix_end, term_end] = mismatch(prefix.begin(), prefix.begin() + offsets[depth], term.begin(), term.end());
+        const auto common_size = static_cast<size_t>(prefix_end - prefix.begin());
+        while (offsets[depth] > common_size) {
+            --depth;
+        }
+        prefix.assign(term);
+
+        bool can_match = true;
+        while (offsets[depth] < term.size() && can_match) {
+            if (states.size() <= depth + 1) {
+                states.emplace_back();
+                offsets.emplace_back();
+            }
+            const string_view c = GetCharacter(term, offsets[depth]);
+            automaton.Step(states[depth], c, states[depth + 1]);
+            offsets[depth + 1] = offsets[depth] + c.size();
+            can_match = automaton.CanMatch(states[++depth]);
+        }
+        if (!can_match) {
+            // Ни один терм с префиксом из первых depth символов не подойдёт: заменяем его последний символ
+            // наименьшим живым, а если такого нет — поднимаемся на уровень выше
+            bool has_next_prefix = false;
+            while (depth > 0 && !has_next_prefix) {
+                --depth;
+                if (automaton.FindNextLiveChar(states[depth], GetCharacter(prefix, offsets[depth]), next_char)) {
+                    prefix.resize(offsets[depth]);
+                    prefix += next_char;
+                    has_next_prefix = true;
+                }
+            }
+            if (!has_next_prefix) {
+                break;
+            }
+            cursor.Seek(prefix);
+            continue;
+        }
+        if (automaton.IsMatch(states[depth])) {
+            terms.push_back({string(term), automaton.GetDistance(states[depth])});
+        }
+        cursor.Next();
+    }
+
+    sort(terms.begin(), terms.end(), [](const FuzzyTerm& lhs, const FuzzyTerm& rhs) {
+        return lhs.distance != rhs.distance ? lhs.distance < rhs.distance : lhs.term < rhs.term;
+    });
+    if (terms.size() > limit) {
+        terms.resize(limit);
+    }
+    return terms;
+}
+
+int ComputeEditDistance(string_view lhs, string_view rhs) {
+    const vector<string_view> rhs_characters = SplitIntoCharacters(rhs);
+    vector<int> row(rhs_characters.size() + 1);
+    iota(row.begin(), row.end(), 0);
+    int i = 0;
+    for (size_t offset = 0; offset < lhs.size();) {
+        const string_view c = GetCharacter(lhs, offset);
+        offset += c.size();
+        int diagonal = row[0];
+        row[0] = ++i;
+        for (size_t j = 1; j < row.size(); ++j) {
+            const int above = row[j];
+            row[j] = min({diagonal + (c == rhs_characters[j - 1] ? 0 : 1), above + 1, row[j - 1] + 1});
+            diagonal = above;
+        }
+    }
+    return row.back();
+}
@@ -0,0 +1,115 @@
+#include "../include/load_tester.h"
+#include "../include/document_ingestion.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <execution>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+QueryLogEntry ParseQueryLogEntry(string_view line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    QueryLogEntry entry;
+    const size_t query_end = line.find('\t');
+    entry.query = string(line.substr(0, query_end));
+    if (query_end == line.npos) {
+        return entry;
+    }
+    line.remove_prefix(query_end + 1);
+
+    const size_t status_end = line.find('\t');
+    entry.status = ParseDocumentStatus(line.substr(0, status_end));
+    if (status_end == line.npos) {
+        return entry;
+    }
+    const string_view top_k = line.substr(status_end + 1);
+    size_t value = 0;
+    const auto [ptr, error] = from_chars(top_k.data(), top_k.data() + top_k.size(), value);
+    if (error != errc() || ptr != top_k.data() + top_k.size() || value == 0) {
+        throw invalid_argument("Invalid K in query log: "s + string(top_k));
+    }
+    entry.top_k = value;
+    return entry;
+}
+
+vector<QueryLogEntry> ReadQueryLog(const string& path) {
+    ifstream input(path);
+    if (!input) {
+        throw invalid_argument("Cannot open "s + path);
+    }
+    vector<QueryLogEntry> query_log;
+    for (string line; getline(input, line);) {
+        if (!line.empty() && line != "\r"s) {
+            query_log.push_back(ParseQueryLogEntry(line));
+        }
+    }
+    return query_log;
+}
+
+double LoadTestReport::GetThroughput() const {
+    return seconds > 0 ? request_count / seconds : 0.0;
+}
+
+LoadTestReport RunLoadTest(const SearchServer& search_server, const vector<QueryLogEntry>& query_log,
+                           const LoadTestOptions& options) {
+    using Clock = chrono::steady_clock;
+    LoadTestReport report;
+    if (query_log.empty()) {
+        return report;
+    }
+    const size_t request_count = options.request_count > 0 ? options.request_count : query_log.size();
+    const size_t concurrency = max<size_t>(options.concurrency, 1);
+    const bool is_open_loop = options.target_qps > 0;
+    const auto interval = is_open_loop
+        ? chrono::duration_cast<Clock::duration>(chrono::duration<double>(1.0 / options.target_qps))
+        : Clock::duration::zero();
+
+    LatencyHistogram histogram;
+    atomic<size_t> next_request{0};
+    atomic<size_t> error_count{0};
+    const auto start_time = Clock::now();
+
+    const auto client = [&] {
+        for (size_t index = next_request.fetch_add(1); index < request_count; index = next_request.fetch_add(1)) {
+            const QueryLogEntry& entry = query_log[index % query_log.size()];
+            auto request_start = Clock::now();
+            if (is_open_loop) {
+                const auto scheduled_time = start_time + interval * static_cast<Clock::rep>(index);
+                this_thread::sleep_until(scheduled_time);
+                request_start = scheduled_time;
+            }
+            try {
+                // Первая страница из K документов: K не ограничен MAX_RESULT_DOCUMENT_COUNT
+                const PageRequest page_request{entry.top_k};
+                SearchPage page = options.use_parallel_policy
+                    ? search_server.FindDocumentsPage(execution::par, entry.query, entry.status, page_request)
+                    : search_server.FindDocumentsPage(execution::seq, entry.query, entry.status, page_request);
+                QueryContext::GetCurrent().Recycle(move(page.documents));
+            } catch (const exception&) {
+                error_count.fetch_add(1, memory_order_relaxed);
+            }
+            histogram.Record(Clock::now() - request_start);
+        }
+    };
+
+    vector<thread> clients;
+    for (size_t i = 0; i < concurrency; ++i) {
+        clients.emplace_back(client);
+    }
+    for (thread& client_thread : clients) {
+        client_thread.join();
+    }
+
+    report.seconds = chrono::duration<double>(Clock::now() - start_time).count();
+    report.request_count = request_count;
+    report.error_count = error_count.load();
+    report.latency = histogram.GetSummary();
+    return report;
+}
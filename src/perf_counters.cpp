@@ -0,0 +1,163 @@
+#include "../include/perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+#ifdef __linux__
+
+struct PerfEventConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+const array<PerfEventConfig, PERF_COUNTER_COUNT> PERF_EVENT_CONFIGS = {{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+                         | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                         | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+}};
+
+int OpenPerfEvent(const PerfEventConfig& event_config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event_config.type;
+    attr.config = event_config.config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+optional<uint64_t> ReadPerfEvent(int descriptor) {
+    // value, time_enabled, time_running
+    uint64_t data[3] = {0, 0, 0};
+    if (read(descriptor, data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) {
+        return nullopt;
+    }
+    if (data[2] == 0) {
+        return data[1] == 0 ? optional<uint64_t>(0) : nullopt;
+    }
+    // Если счётчиков больше, чем регистров PMU, ядро мультиплексирует их — масштабируем
+    if (data[2] < data[1]) {
+        return static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+    }
+    return data[0];
+}
+
+#endif
+
+} // namespace
+
+string_view GetPerfCounterName(PerfCounter counter) {
+    switch (counter) {
+        case PerfCounter::CYCLES:
+            return "cycles"sv;
+        case PerfCounter::INSTRUCTIONS:
+            return "instructions"sv;
+        case PerfCounter::L1D_READ_MISSES:
+            return "L1d misses"sv;
+        case PerfCounter::LLC_MISSES:
+            return "LLC misses"sv;
+        case PerfCounter::BRANCH_MISSES:
+            return "branch misses"sv;
+    }
+    return "unknown"sv;
+}
+
+ostream& operator<<(ostream& output, const PerfCounterValues& values) {
+    output << chrono::duration_cast<chrono::microseconds>(values.duration).count() << " us"s;
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (values.counters[i]) {
+            output << ", "s << GetPerfCounterName(static_cast<PerfCounter>(i)) << " "s << *values.counters[i];
+        }
+    }
+    const auto& cycles = values.Get(PerfCounter::CYCLES);
+    const auto& instructions = values.Get(PerfCounter::INSTRUCTIONS);
+    if (cycles && instructions && *cycles > 0) {
+        output << ", IPC "s << static_cast<double>(*instructions) / *cycles;
+    }
+    return output;
+}
+
+PerfCounters::PerfCounters() {
+    descriptors_.fill(-1);
+#ifdef __linux__
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        descriptors_[i] = OpenPerfEvent(PERF_EVENT_CONFIGS[i]);
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (const int descriptor : descriptors_) {
+        if (descriptor >= 0) {
+            close(descriptor);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::IsAvailable(PerfCounter counter) const {
+    return descriptors_[static_cast<size_t>(counter)] >= 0;
+}
+
+bool PerfCounters::IsAnyAvailable() const {
+    for (const int descriptor : descriptors_) {
+        if (descriptor >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PerfCounters::Start() {
+#ifdef __linux__
+    for (const int descriptor : descriptors_) {
+        if (descriptor >= 0) {
+            ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+            ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+    start_time_ = Clock::now();
+}
+
+PerfCounterValues PerfCounters::Stop() {
+    PerfCounterValues values;
+    values.duration = Clock::now() - start_time_;
+#ifdef __linux__
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (descriptors_[i] >= 0) {
+            ioctl(descriptors_[i], PERF_EVENT_IOC_DISABLE, 0);
+            values.counters[i] = ReadPerfEvent(descriptors_[i]);
+        }
+    }
+#endif
+    return values;
+}
+
+PerfCountersGuard::PerfCountersGuard(string_view id, ostream& stream)
+    : stream_(stream)
+    , id_(id) {
+    counters_.Start();
+}
+
+PerfCountersGuard::~PerfCountersGuard() {
+    stream_ << id_ << ": "s << counters_.Stop() << endl;
+}
@@ -0,0 +1,145 @@
+#include "../include/perfect_hash_set.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+uint64_t Mix(uint64_t value) {
+    value ^= value >> 32;
+    value *= 0xd6e8feb86659fd93ULL;
+    value ^= value >> 32;
+    value *= 0xd6e8feb86659fd93ULL;
+    return value ^ (value >> 32);
+}
+
+// Слово читается по 8 байт
+uint64_t HashWord(string_view word, uint64_t salt) {
+    uint64_t hash = salt ^ (word.size() * 0x9e3779b97f4a7c15ULL);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= word.size(); i += sizeof(uint64_t)) {
+        uint64_t chunk;
+        memcpy(&chunk, word.data() + i, sizeof(chunk));
+        hash = Mix(hash ^ chunk);
+    }
+    uint64_t tail = 0;
+    if (i < word.size()) {
+        memcpy(&tail, word.data() + i, word.size() - i);
+    }
+    return Mix(hash ^ tail);
+}
+
+uint64_t GetLengthBit(size_t size) {
+    return uint64_t{1} << min<size_t>(size, 63);
+}
+
+} // namespace
+
+PerfectHashSet::PerfectHashSet(MemoryCounter* counter)
+    : slots_(CountingAllocator<Slot>(counter))
+    , seeds_(CountingAllocator<uint32_t>(counter))
+    , chars_(CountingAllocator<char>(counter)) {
+}
+
+void PerfectHashSet::Assign(const vector<string_view>& words) {
+    slots_.clear();
+    seeds_.clear();
+    chars_.clear();
+    length_mask_ = 0;
+    if (words.empty()) {
+        return;
+    }
+    const size_t word_count = words.size();
+    if (word_count > numeric_limits<uint32_t>::max()) {
+        throw invalid_argument("Too many words for PerfectHashSet"s);
+    }
+
+    // Слова с одинаковым полным хешем не разделить смещением: меняется соль
+    vector<uint64_t> hashes(word_count);
+    for (salt_ = 0;; ++salt_) {
+        transform(words.begin(), words.end(), hashes.begin(), [this](string_view word) {
+            return HashWord(word, salt_);
+        });
+        vector<uint64_t> sorted_hashes = hashes;
+        sort(sorted_hashes.begin(), sorted_hashes.end());
+        if (adjacent_find(sorted_hashes.begin(), sorted_hashes.end()) == sorted_hashes.end()) {
+            break;
+        }
+    }
+
+    seeds_.assign((word_count + BUCKET_SIZE - 1) / BUCKET_SIZE, 0);
+    slots_.resize(word_count);
+    vector<vector<size_t>> buckets(seeds_.size());
+    for (size_t i = 0; i < word_count; ++i) {
+        buckets[GetBucket(hashes[i])].push_back(i);
+    }
+    // Большие группы размещаются первыми, пока таблица почти пуста
+    vector<size_t> bucket_order(buckets.size());
+    iota(bucket_order.begin(), bucket_order.end(), 0);
+    stable_sort(bucket_order.begin(), bucket_order.end(), [&buckets](size_t lhs, size_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    vector<bool> is_occupied(word_count, false);
+    vector<size_t> bucket_slots;
+    for (const size_t bucket : bucket_order) {
+        if (buckets[bucket].empty()) {
+            break;
+        }
+        for (uint32_t seed = 0;; ++seed) {
+            bucket_slots.clear();
+            for (const size_t word_index : buckets[bucket]) {
+                const size_t slot = GetSlot(hashes[word_index], seed);
+                if (is_occupied[slot] || find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end()) {
+                    break;
+                }
+                bucket_slots.push_back(slot);
+            }
+            if (bucket_slots.size() == buckets[bucket].size()) {
+                seeds_[bucket] = seed;
+                break;
+            }
+        }
+        for (size_t i = 0; i < bucket_slots.size(); ++i) {
+            is_occupied[bucket_slots[i]] = true;
+            slots_[bucket_slots[i]].hash = hashes[buckets[bucket][i]];
+        }
+    }
+
+    for (size_t i = 0; i < word_count; ++i) {
+        Slot& slot = slots_[GetSlot(hashes[i], seeds_[GetBucket(hashes[i])])];
+        slot.offset = static_cast<uint32_t>(chars_.size());
+        slot.size = static_cast<uint32_t>(words[i].size());
+        chars_.insert(chars_.end(), words[i].begin(), words[i].end());
+        length_mask_ |= GetLengthBit(words[i].size());
+    }
+    chars_.shrink_to_fit();
+}
+
+bool PerfectHashSet::Contains(string_view word) const {
+    if ((length_mask_ & GetLengthBit(word.size())) == 0) {
+        return false;
+    }
+    const uint64_t hash = HashWord(word, salt_);
+    const Slot& slot = slots_[GetSlot(hash, seeds_[GetBucket(hash)])];
+    return slot.hash == hash && slot.size == word.size()
+        && memcmp(chars_.data() + slot.offset, word.data(), word.size()) == 0;
+}
+
+size_t PerfectHashSet::GetSize() const {
+    return slots_.size();
+}
+
+size_t PerfectHashSet::GetBucket(uint64_t hash) const {
+    return (hash >> 32) % seeds_.size();
+}
+
+size_t PerfectHashSet::GetSlot(uint64_t hash, uint32_t seed) const {
+    return Mix(hash ^ (seed * 0x9e3779b97f4a7c15ULL)) % slots_.size();
+}
@@ -1,4 +1,5 @@
 #include "../include/process_queries.h"
+#include "../include/trace.h"
 
 #include <algorithm>
 #include <execution>
@@ -6,12 +7,14 @@
 using namespace std;
 
 vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const vector<string>& queries) {
+    TRACE_SCOPE("ProcessQueries");
     vector<vector<Document>> documents_lists(queries.size());
     transform(
         execution::par,
         queries.begin(), queries.end(),
         documents_lists.begin(),
         [&search_server](const string& query) {
+            TRACE_SCOPE("ProcessQueries: query");
             return search_server.FindTopDocuments(query);
         });
     return documents_lists;
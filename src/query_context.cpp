@@ -0,0 +1,111 @@
+#include "../include/query_context.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+thread_local QueryContext* installed_context = nullptr;
+
+} // namespace
+
+QueryContext::QueryContext(size_t arena_bytes)
+    : arena_(make_unique<byte[]>(max<size_t>(arena_bytes, 1)))
+    , arena_bytes_(max<size_t>(arena_bytes, 1))
+    , relevance_map_(RELEVANCE_BUCKET_COUNT) {
+}
+
+QueryContext& QueryContext::GetCurrent() {
+    if (installed_context != nullptr) {
+        return *installed_context;
+    }
+    thread_local QueryContext context;
+    return context;
+}
+
+void QueryContext::Recycle(vector<Document>&& documents) {
+    if (documents.capacity() > results_.capacity()) {
+        results_ = move(documents);
+    }
+}
+
+size_t QueryContext::GetArenaBytes() const {
+    return arena_bytes_;
+}
+
+QueryContext::Lease::Lease(QueryContext& context) {
+    if (context.is_leased_) {
+        arena_.emplace();
+        return;
+    }
+    context_ = &context;
+    context_->is_leased_ = true;
+    arena_.emplace(context_->arena_.get(), context_->arena_bytes_, &context_->overflow_);
+}
+
+QueryContext::Lease::~Lease() {
+    // Сначала память сверх буфера возвращается в кучу
+    arena_.reset();
+    if (context_ == nullptr) {
+        return;
+    }
+    const size_t overflow_bytes = context_->overflow_.TakeRequestedBytes();
+    if (overflow_bytes > 0 && context_->arena_bytes_ < MAX_ARENA_BYTES) {
+        context_->arena_bytes_ = min(context_->arena_bytes_ + overflow_bytes, MAX_ARENA_BYTES);
+        context_->arena_ = make_unique<byte[]>(context_->arena_bytes_);
+    }
+    context_->relevance_map_.Clear();
+    context_->is_leased_ = false;
+}
+
+pmr::memory_resource* QueryContext::Lease::GetResource() {
+    return &*arena_;
+}
+
+ConcurrentMap<int, double>& QueryContext::Lease::GetRelevanceMap() {
+    if (context_ != nullptr) {
+        return context_->relevance_map_;
+    }
+    if (!relevance_map_) {
+        relevance_map_.emplace(RELEVANCE_BUCKET_COUNT);
+    }
+    return *relevance_map_;
+}
+
+vector<Document> QueryContext::Lease::TakeResults() {
+    if (context_ == nullptr) {
+        return {};
+    }
+    vector<Document> results = move(context_->results_);
+    context_->results_ = {};
+    results.clear();
+    return results;
+}
+
+size_t QueryContext::OverflowResource::TakeRequestedBytes() {
+    return exchange(requested_bytes_, 0);
+}
+
+void* QueryContext::OverflowResource::do_allocate(size_t bytes, size_t alignment) {
+    requested_bytes_ += bytes;
+    return pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void QueryContext::OverflowResource::do_deallocate(void* pointer, size_t bytes, size_t alignment) {
+    pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+}
+
+bool QueryContext::OverflowResource::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+QueryContextScope::QueryContextScope(QueryContext& context)
+    : previous_(installed_context) {
+    installed_context = &context;
+}
+
+QueryContextScope::~QueryContextScope() {
+    installed_context = previous_;
+}
@@ -1,64 +1,357 @@
 #include "../include/search_server.h"
 
+#include <algorithm>
+#include <charconv>
 #include <cmath>
 #include <execution>
 #include <iterator>
+#include <limits>
+#include <numeric>
 
 using namespace std;
 
-SearchServer::SearchServer(string_view stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text))
+size_t MemoryStats::GetIndexBytes() const {
+    return dictionary + postings + positions + term_dictionary + impact_postings;
+}
+
+size_t MemoryStats::GetTotalBytes() const {
+    return document_texts + documents + document_words + document_ids + stop_words + rating_index + GetIndexBytes();
+}
+
+SearchServer::SearchServer(string_view stop_words_text, const SearchServerOptions& options)
+    : SearchServer(SplitIntoWords(stop_words_text), options)
 {
 }
 
-SearchServer::SearchServer(const string& stop_words_text)
-    : SearchServer(string_view(stop_words_text))
+SearchServer::SearchServer(const string& stop_words_text, const SearchServerOptions& options)
+    : SearchServer(string_view(stop_words_text), options)
 {
 }
 
-SearchServer::SearchServer(const char*  stop_words_text)
-: SearchServer(string_view(stop_words_text))
+SearchServer::SearchServer(const char*  stop_words_text, const SearchServerOptions& options)
+: SearchServer(string_view(stop_words_text), options)
 {
 }
 
 void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status,
                                const vector<int>& ratings) {
+    TRACE_SCOPE("AddDocument");
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw invalid_argument("Invalid document_id"s);
     }
-    const auto [it, inserted] = documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, string(document)});
-    const auto words = SplitIntoWordsNoStop(it->second.text);
+    const auto [it, inserted] = documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, MakeDocumentText(document)});
+    vector<string_view> words;
+    try {
+        words = SplitIntoWordsNoStop(it->second.text);
+    } catch (...) {
+        documents_.erase(it);
+        throw;
+    }
+    IndexDocument(document_id, words);
+    UpdateTermDictionary();
+}
+
+void SearchServer::AddDocuments(const vector<DocumentRecord>& documents) {
+    AddDocuments(execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const execution::sequenced_policy& policy, const vector<DocumentRecord>& documents) {
+    AddDocuments(documents, TokenizeDocuments(policy, documents));
+}
+
+void SearchServer::AddDocuments(const execution::parallel_policy& policy, const vector<DocumentRecord>& documents) {
+    AddDocuments(documents, TokenizeDocuments(policy, documents));
+}
+
+void SearchServer::AddDocuments(const vector<DocumentRecord>& documents, DocumentsWords documents_words) {
+    CheckNewDocumentIds(documents);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const DocumentRecord& document = documents[i];
+        const auto [it, inserted] = documents_.emplace(document.id, DocumentData{ComputeAverageRating(document.ratings), document.status, MakeDocumentText(document.text)});
+        // Слова указывают на текст из пакета — переносим их на сохранённую копию
+        const char* stored_text = it->second.text.data();
+        for (string_view& word : documents_words[i]) {
+            word = string_view(stored_text + (word.data() - document.text.data()), word.size());
+        }
+        IndexDocument(document.id, documents_words[i]);
+    }
+    UpdateTermDictionary();
+}
+
+SearchServer::DocumentsWords SearchServer::TokenizeDocuments(const execution::sequenced_policy& policy, const vector<DocumentRecord>& documents) const {
+    return TokenizeDocumentsImpl(policy, documents);
+}
+
+SearchServer::DocumentsWords SearchServer::TokenizeDocuments(const execution::parallel_policy& policy, const vector<DocumentRecord>& documents) const {
+    return TokenizeDocumentsImpl(policy, documents);
+}
+
+void SearchServer::CheckNewDocumentIds(const vector<DocumentRecord>& documents) const {
+    set<int> batch_ids;
+    for (const DocumentRecord& document : documents) {
+        if (document.id < 0 || documents_.count(document.id) > 0 || !batch_ids.insert(document.id).second) {
+            throw invalid_argument("Invalid document_id"s);
+        }
+    }
+}
+
+template <typename ExecutionPolicy>
+SearchServer::DocumentsWords SearchServer::TokenizeDocumentsImpl(const ExecutionPolicy& policy, const vector<DocumentRecord>& documents) const {
+    // Исключения внутри параллельного алгоритма приводят к std::terminate,
+    // поэтому ошибки разбора только отмечаем и повторяем разбор снаружи
+    DocumentsWords documents_words(documents.size());
+    vector<char> is_valid(documents.size(), 1);
+    vector<size_t> indexes(documents.size());
+    iota(indexes.begin(), indexes.end(), 0);
+    for_each(policy, indexes.begin(), indexes.end(),
+        [this, &documents, &documents_words, &is_valid](size_t i) {
+            try {
+                documents_words[i] = TokenizeDocument(documents[i].text);
+            } catch (const invalid_argument&) {
+                is_valid[i] = 0;
+            }
+        });
+    const auto invalid = find(is_valid.begin(), is_valid.end(), 0);
+    if (invalid != is_valid.end()) {
+        TokenizeDocument(documents[static_cast<size_t>(invalid - is_valid.begin())].text);
+    }
+    return documents_words;
+}
+
+vector<string_view> SearchServer::TokenizeDocument(string_view text) const {
+    if (!options_.normalize_text) {
+        return SplitIntoWordsNoStop(text);
+    }
+    string normalized_text(text.size(), ' ');
+    NormalizeText(text, normalized_text.data(), DOCUMENT_KEPT_PUNCTUATION);
+    vector<string_view> words = SplitIntoWordsNoStop(normalized_text);
+    // Нормализация не меняет длину текста, поэтому слова переносятся на исходный текст по смещению
+    for (string_view& word : words) {
+        word = text.substr(word.data() - normalized_text.data(), word.size());
+    }
+    return words;
+}
 
+void SearchServer::IndexDocument(int document_id, const vector<string_view>& words) {
     const double inv_word_count = 1.0 / words.size();
+    documents_.at(document_id).word_count = words.size();
+    total_word_count_ += words.size();
     for (const string_view word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
+        auto& document_freqs = word_to_document_freqs_[word];
+        if (document_freqs.empty()) {
+            AddDictionaryTerm(word);
+        }
+        document_freqs[document_id] += inv_word_count;
         document_to_word_freqs_[document_id][word] += inv_word_count;
     }
+    if (options_.positional_index) {
+        IndexPositions(document_id);
+    }
+    if (options_.impact_ordered_postings && !words.empty()) {
+        IndexImpacts(document_id);
+    }
     document_ids_.insert(document_id);
+    rating_index_.emplace(documents_.at(document_id).rating, document_id);
+}
+
+void SearchServer::IndexPositions(int document_id) {
+    auto& word_positions = document_to_word_positions_[document_id];
+    uint32_t position = 0;
+    for (const string_view word : SplitIntoWords(documents_.at(document_id).text)) {
+        if (!IsStopWord(word)) {
+            word_positions[word].Append(position);
+        }
+        ++position;
+    }
+}
+
+void SearchServer::IndexImpacts(int document_id) {
+    for (const auto& [word, term_freq] : document_to_word_freqs_.at(document_id)) {
+        const string_view key = word_to_document_freqs_.find(word)->first;
+        word_impacts_[key].insert({term_freq, document_id});
+    }
+}
+
+void SearchServer::ReleaseWordKey(string_view word, int removed_document_id) {
+    const auto it = word_to_document_freqs_.find(word);
+    const auto impacts = word_impacts_.find(word);
+    if (it->second.empty()) {
+        RemoveDictionaryTerm(word);
+        word_to_document_freqs_.erase(it);
+        if (impacts != word_impacts_.end()) {
+            word_impacts_.erase(impacts);
+        }
+        return;
+    }
+    const DocumentText& text = documents_.at(removed_document_id).text;
+    const less<const char*> before;
+    if (before(it->first.data(), text.data()) || !before(it->first.data(), text.data() + text.size())) {
+        return;
+    }
+    const int remaining_id = it->second.begin()->first;
+    const string_view remaining_key = document_to_word_freqs_.at(remaining_id).find(word)->first;
+    auto node = word_to_document_freqs_.extract(it);
+    node.key() = remaining_key;
+    word_to_document_freqs_.insert(move(node));
+    if (impacts != word_impacts_.end()) {
+        auto impacts_node = word_impacts_.extract(impacts);
+        impacts_node.key() = remaining_key;
+        word_impacts_.insert(move(impacts_node));
+    }
+}
+
+bool SearchServer::HasTermDictionary() const {
+    return options_.wildcard_query_words || options_.fuzzy_query_words;
+}
+
+void SearchServer::AddDictionaryTerm(string_view word) {
+    if (!HasTermDictionary()) {
+        return;
+    }
+    TermDictionaries& dictionaries = term_dictionaries_;
+    // Слово, удалённое и снова добавленное, так и осталось в main
+    const auto removed = dictionaries.removed_terms.find(word);
+    if (removed != dictionaries.removed_terms.end()) {
+        dictionaries.removed_terms.erase(removed);
+        return;
+    }
+    dictionaries.recent_terms.emplace(word);
+    dictionaries.is_recent_dirty = true;
+}
+
+void SearchServer::RemoveDictionaryTerm(string_view word) {
+    if (!HasTermDictionary()) {
+        return;
+    }
+    TermDictionaries& dictionaries = term_dictionaries_;
+    const auto recent = dictionaries.recent_terms.find(word);
+    if (recent != dictionaries.recent_terms.end()) {
+        dictionaries.recent_terms.erase(recent);
+        dictionaries.is_recent_dirty = true;
+        return;
+    }
+    dictionaries.removed_terms.emplace(word);
+}
+
+void SearchServer::UpdateTermDictionary() {
+    TermDictionaries& dictionaries = term_dictionaries_;
+    const size_t change_count = dictionaries.recent_terms.size() + dictionaries.removed_terms.size();
+    const auto merge_size = static_cast<size_t>(sqrt(static_cast<double>(dictionaries.main.GetTermCount())));
+    if (change_count > max(MIN_TERM_DICTIONARY_MERGE_SIZE, merge_size)) {
+        vector<string_view> terms;
+        terms.reserve(word_to_document_freqs_.size());
+        for (const auto& [word, _] : word_to_document_freqs_) {
+            terms.push_back(word);
+        }
+        dictionaries.main.Assign(terms);
+        dictionaries.recent.Assign({});
+        dictionaries.recent_terms.clear();
+        dictionaries.removed_terms.clear();
+        dictionaries.is_recent_dirty = false;
+    } else if (dictionaries.is_recent_dirty) {
+        dictionaries.recent.Assign(vector<string_view>(dictionaries.recent_terms.begin(), dictionaries.recent_terms.end()));
+        dictionaries.is_recent_dirty = false;
+    }
+}
+
+size_t SearchServer::GetMainDictionaryLimit() const {
+    const size_t removed_count = term_dictionaries_.removed_terms.size();
+    const size_t limit = options_.max_term_expansions;
+    return limit > numeric_limits<size_t>::max() - removed_count ? limit : limit + removed_count;
+}
+
+vector<string_view> SearchServer::ExpandPattern(string_view pattern) const {
+    // Слова recent и main не пересекаются, а слова main, удалённые из индекса, отбрасываются
+    vector<string> terms = term_dictionaries_.recent.FindByPattern(pattern, options_.max_term_expansions);
+    for (string& term : term_dictionaries_.main.FindByPattern(pattern, GetMainDictionaryLimit())) {
+        terms.push_back(move(term));
+    }
+    sort(terms.begin(), terms.end());
+    vector<string_view> words;
+    for (const string& term : terms) {
+        const auto it = word_to_document_freqs_.find(term);
+        if (it != word_to_document_freqs_.end() && words.size() < options_.max_term_expansions) {
+            words.push_back(it->first);
+        }
+    }
+    return words;
 }
 
-vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(std::execution::seq,raw_query, status);
+vector<string_view> SearchServer::ExpandFuzzy(string_view word, int max_edit_distance) const {
+    vector<FuzzyTerm> terms = FindFuzzyTerms(term_dictionaries_.recent, word, max_edit_distance, options_.max_term_expansions);
+    for (FuzzyTerm& term : FindFuzzyTerms(term_dictionaries_.main, word, max_edit_distance, GetMainDictionaryLimit())) {
+        terms.push_back(move(term));
+    }
+    sort(terms.begin(), terms.end(), [](const FuzzyTerm& lhs, const FuzzyTerm& rhs) {
+        return lhs.distance != rhs.distance ? lhs.distance < rhs.distance : lhs.term < rhs.term;
+    });
+    vector<string_view> words;
+    for (const FuzzyTerm& term : terms) {
+        const auto it = word_to_document_freqs_.find(term.term);
+        if (it != word_to_document_freqs_.end() && words.size() < options_.max_term_expansions) {
+            words.push_back(it->first);
+        }
+    }
+    return words;
 }
 
-vector<Document> SearchServer::FindTopDocuments(string_view raw_query) const {
-    return FindTopDocuments(std::execution::seq, raw_query);
+bool SearchServer::IsSingleWordQuery(const Query& query) {
+    return query.plus_words.size() == 1 && query.minus_words.empty() && query.phrases.empty() && query.minus_phrases.empty();
+}
+
+bool SearchServer::IsRankedBefore(const Document& lhs, const Document& rhs) {
+    if (abs(lhs.relevance - rhs.relevance) >= RELEVANCE_EPSILON) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+vector<Document> SearchServer::SelectTopDocuments(const pmr::vector<Document>& documents, const optional<SearchCursor>& after, size_t limit,
+                                                  vector<Document> top_documents) {
+    top_documents.clear();
+    if (limit == 0) {
+        return top_documents;
+    }
+    top_documents.reserve(min(limit, documents.size()));
+    // На вершине кучи — худший из отобранных документов
+    for (const Document& document : documents) {
+        if (after && !IsRankedBefore(Document{after->id, after->relevance, after->rating}, document)) {
+            continue;
+        }
+        if (top_documents.size() < limit) {
+            top_documents.push_back(document);
+            push_heap(top_documents.begin(), top_documents.end(), IsRankedBefore);
+        } else if (IsRankedBefore(document, top_documents.front())) {
+            pop_heap(top_documents.begin(), top_documents.end(), IsRankedBefore);
+            top_documents.back() = document;
+            push_heap(top_documents.begin(), top_documents.end(), IsRankedBefore);
+        }
+    }
+    sort_heap(top_documents.begin(), top_documents.end(), IsRankedBefore);
+    return top_documents;
 }
 
 int SearchServer::GetDocumentCount() const {
     return documents_.size();
 }
 
-set<int>::const_iterator SearchServer::begin() const {
+size_t SearchServer::GetWordCount() const {
+    return word_to_document_freqs_.size();
+}
+
+SearchServer::DocumentIds::const_iterator SearchServer::begin() const {
     return document_ids_.begin();
 }
 
-set<int>::const_iterator SearchServer::end() const {
+SearchServer::DocumentIds::const_iterator SearchServer::end() const {
     return document_ids_.end();
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static const map<string_view, double> dummy;
+const SearchServer::WordFrequencies& SearchServer::GetWordFrequencies(int document_id) const {
+    static const WordFrequencies dummy;
     if (document_to_word_freqs_.count(document_id) == 0) {
         return dummy;
     }
@@ -71,43 +364,22 @@ SearchServer::MatchDocumentResult SearchServer::MatchDocument(string_view raw_qu
 }
 
 SearchServer::MatchDocumentResult SearchServer::MatchDocument(const execution::sequenced_policy&, string_view raw_query, int document_id) const {
-    const auto query = ParseQuery(raw_query);
-
-    const auto status = documents_.at(document_id).status;
-
-    for (const string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            return {std::vector<std::string_view>{}, status};
-        }
-    }
-
-    vector<string_view> matched_words;
-    for (const string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
-        }
-    }
-    return {matched_words, status};
+    return MatchParsedQuery(ParseQuery(raw_query), document_id);
 }
 
 SearchServer::MatchDocumentResult SearchServer::MatchDocument(const execution::parallel_policy&, string_view raw_query, int document_id) const {
     const auto query = ParseQuery(raw_query, /* skip_sort */ true);
 
     const auto status = documents_.at(document_id).status;
+    const auto& word_freqs = GetWordFrequencies(document_id);
 
     const auto word_checker =
-        [this, document_id](string_view word) {
-            const auto it = word_to_document_freqs_.find(word);
-            return it != word_to_document_freqs_.end() && it->second.count(document_id);
+        [&word_freqs](string_view word) {
+            return word_freqs.count(word) > 0;
         };
 
-    if (any_of(execution::par, query.minus_words.begin(), query.minus_words.end(), word_checker)) {
+    if (any_of(execution::par, query.minus_words.begin(), query.minus_words.end(), word_checker)
+        || !MatchesPhrases(query, document_id)) {
         return {std::vector<std::string_view>{}, status};
     }
 
@@ -121,12 +393,129 @@ SearchServer::MatchDocumentResult SearchServer::MatchDocument(const execution::p
     sort(matched_words.begin(), words_end);
     words_end = unique(matched_words.begin(), words_end);
     matched_words.erase(words_end, matched_words.end());
+    for (string_view& word : matched_words) {
+        word = word_freqs.find(word)->first;
+    }
 
     return {matched_words, status};
 }
 
+vector<SearchServer::MatchDocumentResult> SearchServer::MatchDocuments(string_view raw_query, const vector<int>& document_ids) const {
+    return MatchDocuments(execution::seq, raw_query, document_ids);
+}
+
+vector<SearchServer::MatchDocumentResult> SearchServer::MatchDocuments(const execution::sequenced_policy& policy, string_view raw_query, const vector<int>& document_ids) const {
+    return MatchDocumentsImpl(policy, raw_query, document_ids);
+}
+
+vector<SearchServer::MatchDocumentResult> SearchServer::MatchDocuments(const execution::parallel_policy& policy, string_view raw_query, const vector<int>& document_ids) const {
+    return MatchDocumentsImpl(policy, raw_query, document_ids);
+}
+
+template <typename ExecutionPolicy>
+vector<SearchServer::MatchDocumentResult> SearchServer::MatchDocumentsImpl(const ExecutionPolicy& policy, string_view raw_query, const vector<int>& document_ids) const {
+    const auto query = ParseQuery(raw_query);
+    // Исключение внутри параллельного алгоритма привело бы к std::terminate
+    for (const int document_id : document_ids) {
+        if (documents_.count(document_id) == 0) {
+            throw out_of_range("Invalid document_id "s + to_string(document_id));
+        }
+    }
+
+    vector<MatchDocumentResult> results(document_ids.size());
+    transform(policy, document_ids.begin(), document_ids.end(), results.begin(),
+        [this, &query](int document_id) {
+            return MatchParsedQuery(query, document_id);
+        });
+    return results;
+}
+
+namespace {
+
+// Поиск в дереве из size элементов проходит около log2(size) узлов
+size_t GetTreeDepth(size_t size) {
+    size_t depth = 1;
+    for (; size > 1; size >>= 1) {
+        ++depth;
+    }
+    return depth;
+}
+
+// Слова запроса без разбора: оценка работы до него
+size_t CountQueryWords(string_view raw_query) {
+    size_t word_count = 0;
+    char previous = ' ';
+    for (const char c : raw_query) {
+        word_count += previous == ' ' && c != ' ' ? 1 : 0;
+        previous = c;
+    }
+    return word_count;
+}
+
+// Возвращает слова из отсортированного words, которые есть в словаре документа, но не более limit.
+// Короткий список ищется в словаре по одному слову, длинный — слиянием с отсортированным словарём.
+// Результат указывает на слова документа: нормализованный запрос живёт только до конца поиска.
+template <typename Words, typename WordFrequencies>
+vector<string_view> IntersectWords(const Words& words, const WordFrequencies& word_freqs, size_t limit = numeric_limits<size_t>::max()) {
+    vector<string_view> result;
+    if (words.empty() || word_freqs.empty()) {
+        return result;
+    }
+    const size_t lookup_cost = GetTreeDepth(word_freqs.size());
+    if (words.size() * lookup_cost < words.size() + word_freqs.size()) {
+        for (const string_view word : words) {
+            const auto it = word_freqs.find(word);
+            if (result.size() < limit && it != word_freqs.end()) {
+                result.push_back(it->first);
+            }
+        }
+        return result;
+    }
+
+    auto it = word_freqs.begin();
+    for (const string_view word : words) {
+        while (it != word_freqs.end() && it->first < word) {
+            ++it;
+        }
+        if (it == word_freqs.end() || result.size() >= limit) {
+            break;
+        }
+        if (it->first == word) {
+            result.push_back(it->first);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+SearchServer::MatchDocumentResult SearchServer::MatchParsedQuery(const Query& query, int document_id) const {
+    const auto status = documents_.at(document_id).status;
+    const auto& word_freqs = GetWordFrequencies(document_id);
+
+    if (!IntersectWords(query.minus_words, word_freqs, 1).empty() || !MatchesPhrases(query, document_id)) {
+        return {std::vector<std::string_view>{}, status};
+    }
+    return {IntersectWords(query.plus_words, word_freqs), status};
+}
+
+SearchServer::MatchDocumentResult SearchServer::MatchDocument(const AdaptivePolicy&, string_view raw_query, int document_id) const {
+    // Каждое слово запроса ищется в словах документа
+    const size_t word_count = CountQueryWords(raw_query);
+    const size_t lookup_cost = GetTreeDepth(GetWordFrequencies(document_id).size());
+    const ExecutionPlan plan = GetExecutionPlanner().Plan(word_count * lookup_cost, lookup_cost, word_count);
+    if (!plan.IsParallel()) {
+        return MatchDocument(execution::seq, raw_query, document_id);
+    }
+    MatchDocumentResult result;
+    ExecutionPlanner::Execute(plan, [&] {
+        result = MatchDocument(execution::par, raw_query, document_id);
+    });
+    return result;
+}
+
 bool SearchServer::IsStopWord(string_view word) const {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Contains(word);
 }
 
 bool SearchServer::IsValidWord(string_view word) {
@@ -172,14 +561,82 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string_view word) const {
         throw std::invalid_argument("Query word "s + string(word) + " is invalid");
     }
 
-    return {word, is_minus, IsStopWord(word)};
+    // word~ и word~N — нечёткое слово, word~ равносильно word~1
+    int max_edit_distance = 0;
+    const size_t tilde = word.rfind('~');
+    if (options_.fuzzy_query_words && tilde != word.npos && tilde > 0 && word.size() - tilde <= 2) {
+        const string_view distance = word.substr(tilde + 1);
+        if (distance.empty() || (distance[0] >= '0' && distance[0] <= '9')) {
+            max_edit_distance = distance.empty() ? 1 : distance[0] - '0';
+            if (max_edit_distance > MAX_FUZZY_EDIT_DISTANCE) {
+                throw invalid_argument("Edit distance in "s + string(word) + " is too large"s);
+            }
+            word = word.substr(0, tilde);
+        }
+    }
+    const bool is_pattern = options_.wildcard_query_words && word.find_first_of("*?"sv) != word.npos;
+    if (is_pattern && max_edit_distance > 0) {
+        throw invalid_argument("Query word "s + string(word) + " cannot be both fuzzy and pattern"s);
+    }
+    return {word, is_minus, IsStopWord(word), is_pattern, max_edit_distance};
 }
 
-SearchServer::Query SearchServer::ParseQuery(string_view text, bool skip_sort) const {
-    Query result;
-    for (const string_view word : SplitIntoWords(text)) {
+SearchServer::Query SearchServer::ParseQuery(string_view text, bool skip_sort, pmr::memory_resource* resource) const {
+    Query result(resource);
+    if (options_.normalize_text) {
+        result.normalized_text.resize(text.size());
+        NormalizeText(text, result.normalized_text.data(), query_kept_punctuation_);
+        text = string_view(result.normalized_text.data(), result.normalized_text.size());
+    }
+    const pmr::vector<string_view> words = SplitIntoWords(text, resource);
+    for (size_t i = 0; i < words.size(); ++i) {
+        string_view word = words[i];
+        const bool is_minus_phrase = word.substr(0, 2) == "-\""sv;
+        if (options_.positional_index && (is_minus_phrase || word[0] == '"')) {
+            word.remove_prefix(is_minus_phrase ? 2 : 1);
+            // Фразу закрывает слово, оканчивающееся кавычкой или кавычкой с допуском ~N
+            vector<string_view> phrase_words;
+            string_view slop;
+            while (true) {
+                const size_t quote = word.rfind('"');
+                if (quote != word.npos && (quote + 1 == word.size() || word[quote + 1] == '~')) {
+                    slop = word.substr(quote + 1);
+                    word = word.substr(0, quote);
+                    if (!word.empty()) {
+                        phrase_words.push_back(word);
+                    }
+                    break;
+                }
+                if (!word.empty()) {
+                    phrase_words.push_back(word);
+                }
+                if (++i == words.size()) {
+                    throw invalid_argument("Phrase is not closed"s);
+                }
+                word = words[i];
+            }
+            Phrase phrase = ParsePhrase(phrase_words, slop);
+            // Фраза из одних стоп-слов ничего не ограничивает
+            if (phrase.words.empty()) {
+                continue;
+            }
+            if (is_minus_phrase) {
+                result.minus_phrases.push_back(move(phrase));
+            } else {
+                result.plus_words.insert(result.plus_words.end(), phrase.words.begin(), phrase.words.end());
+                result.phrases.push_back(move(phrase));
+            }
+            continue;
+        }
+
         const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
+        if (query_word.is_pattern || query_word.max_edit_distance > 0) {
+            auto& words = query_word.is_minus ? result.minus_words : result.plus_words;
+            const vector<string_view> expanded_words = query_word.is_pattern
+                ? ExpandPattern(query_word.data)
+                : ExpandFuzzy(query_word.data, query_word.max_edit_distance);
+            words.insert(words.end(), expanded_words.begin(), expanded_words.end());
+        } else if (!query_word.is_stop) {
             if (query_word.is_minus) {
                 result.minus_words.push_back(query_word.data);
             } else {
@@ -196,9 +653,253 @@ SearchServer::Query SearchServer::ParseQuery(string_view text, bool skip_sort) c
     return result;
 }
 
-// Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+SearchServer::Phrase SearchServer::ParsePhrase(const vector<string_view>& words, string_view slop) const {
+    if (words.empty()) {
+        throw invalid_argument("Phrase is empty"s);
+    }
+    Phrase phrase;
+    for (uint32_t offset = 0; offset < words.size(); ++offset) {
+        const auto query_word = ParseQueryWord(words[offset]);
+        if (query_word.is_minus || query_word.is_pattern || query_word.max_edit_distance > 0) {
+            throw invalid_argument("Word "s + string(words[offset]) + " is not allowed inside phrase"s);
+        }
+        if (!query_word.is_stop) {
+            phrase.words.push_back(query_word.data);
+            phrase.offsets.push_back(offset);
+        }
+    }
+    if (!slop.empty()) {
+        slop.remove_prefix(1);
+        const auto [ptr, error] = from_chars(slop.data(), slop.data() + slop.size(), phrase.slop);
+        if (slop.empty() || error != errc() || ptr != slop.data() + slop.size()) {
+            throw invalid_argument("Invalid phrase slop "s + string(slop));
+        }
+    }
+    return phrase;
+}
+
+bool SearchServer::ContainsPhrase(const Phrase& phrase, int document_id) const {
+    const auto word_positions = document_to_word_positions_.find(document_id);
+    if (word_positions == document_to_word_positions_.end()) {
+        return false;
+    }
+    vector<vector<uint32_t>> positions;
+    positions.reserve(phrase.words.size());
+    for (const string_view word : phrase.words) {
+        const auto it = word_positions->second.find(word);
+        if (it == word_positions->second.end()) {
+            return false;
+        }
+        positions.push_back(it->second.Decode());
+    }
+
+    // Для каждого вхождения первого слова берём ближайшие подходящие вхождения следующих:
+    // лишние позиции в сумме равны расстоянию до последнего слова, и жадный выбор его минимизирует
+    for (const uint32_t start : positions[0]) {
+        uint32_t previous = start;
+        uint32_t extra = 0;
+        bool is_matched = true;
+        for (size_t i = 1; i < positions.size(); ++i) {
+            const uint32_t gap = phrase.offsets[i] - phrase.offsets[i - 1];
+            const auto next = lower_bound(positions[i].begin(), positions[i].end(), previous + gap);
+            if (next == positions[i].end()) {
+                // Для более поздних вхождений первого слова продолжения тоже не найдётся
+                return false;
+            }
+            extra += *next - previous - gap;
+            if (extra > phrase.slop) {
+                is_matched = false;
+                break;
+            }
+            previous = *next;
+        }
+        if (is_matched) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SearchServer::MatchesPhrases(const Query& query, int document_id) const {
+    return all_of(query.phrases.begin(), query.phrases.end(), [this, document_id](const Phrase& phrase) {
+            return ContainsPhrase(phrase, document_id);
+        })
+        && none_of(query.minus_phrases.begin(), query.minus_phrases.end(), [this, document_id](const Phrase& phrase) {
+            return ContainsPhrase(phrase, document_id);
+        });
+}
+
+optional<pmr::vector<int>> SearchServer::FindPhraseDocuments(const Query& query, pmr::memory_resource* resource) const {
+    if (query.phrases.empty()) {
+        return nullopt;
+    }
+    // Кандидаты — документы самого короткого списка, которые есть в списках всех слов фраз
+    const DocumentFrequencies* shortest_postings = nullptr;
+    pmr::vector<const DocumentFrequencies*> postings(resource);
+    for (const Phrase& phrase : query.phrases) {
+        for (const string_view word : phrase.words) {
+            const auto it = word_to_document_freqs_.find(word);
+            if (it == word_to_document_freqs_.end()) {
+                return pmr::vector<int>(resource);
+            }
+            postings.push_back(&it->second);
+            if (shortest_postings == nullptr || it->second.size() < shortest_postings->size()) {
+                shortest_postings = &it->second;
+            }
+        }
+    }
+
+    pmr::vector<int> document_ids(resource);
+    for (const auto& [document_id, _] : *shortest_postings) {
+        const int id = document_id;
+        const bool has_all_words = all_of(postings.begin(), postings.end(), [id](const DocumentFrequencies* word_postings) {
+            return word_postings->count(id) > 0;
+        });
+        const bool has_all_phrases = has_all_words && all_of(query.phrases.begin(), query.phrases.end(), [this, id](const Phrase& phrase) {
+            return ContainsPhrase(phrase, id);
+        });
+        if (has_all_phrases) {
+            document_ids.push_back(id);
+        }
+    }
+    return document_ids;
+}
+
+optional<pmr::vector<int>> SearchServer::FindRatingDocuments(const RatingRange& ratings, size_t max_count,
+                                                             pmr::memory_resource* resource) const {
+    pmr::vector<int> document_ids(resource);
+    if (ratings.min_rating > ratings.max_rating) {
+        return document_ids;
+    }
+    const auto last = rating_index_.upper_bound({ratings.max_rating, numeric_limits<int>::max()});
+    for (auto it = rating_index_.lower_bound({ratings.min_rating, numeric_limits<int>::min()}); it != last; ++it) {
+        if (document_ids.size() == max_count) {
+            return nullopt;
+        }
+        document_ids.push_back(it->second);
+    }
+    sort(document_ids.begin(), document_ids.end());
+    return document_ids;
+}
+
+optional<pmr::vector<int>> SearchServer::FindCandidateDocuments(const Query& query, const optional<RatingRange>& ratings,
+                                                                pmr::memory_resource* resource) const {
+    auto phrase_documents = FindPhraseDocuments(query, resource);
+    // Рейтинг документов с фразами проверяет предикат
+    if (phrase_documents || !ratings) {
+        return phrase_documents;
+    }
+    size_t max_count = 0;
+    for (const string_view word : query.plus_words) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it != word_to_document_freqs_.end()) {
+            max_count = max(max_count, GetMaxLookupCount(it->second.size()));
+        }
+    }
+    return FindRatingDocuments(*ratings, max_count, resource);
+}
+
+size_t SearchServer::GetMaxLookupCount(size_t posting_count) {
+    return posting_count / GetTreeDepth(posting_count);
+}
+
+ScoringContext SearchServer::GetScoringContext() const {
+    ScoringContext context;
+    context.document_count = static_cast<size_t>(GetDocumentCount());
+    if (total_word_count_ > 0) {
+        context.inverse_average_document_length = context.document_count * 1.0 / total_word_count_;
+    }
+    return context;
+}
+
+const ExecutionPlanner& SearchServer::GetExecutionPlanner() const {
+    return options_.execution_planner != nullptr ? *options_.execution_planner : ExecutionPlanner::GetCalibrated();
+}
+
+ExecutionPlan SearchServer::PlanQuery(const Query& query) const {
+    size_t work = 0;
+    size_t max_task_work = 0;
+    for (const auto* words : {&query.plus_words, &query.minus_words}) {
+        for (const string_view word : *words) {
+            const auto postings = word_to_document_freqs_.find(word);
+            if (postings != word_to_document_freqs_.end()) {
+                work += postings->second.size();
+                max_task_work = max(max_task_work, postings->second.size());
+            }
+        }
+    }
+    // Параллельный поиск делит работу по словам запроса
+    return GetExecutionPlanner().Plan(work, max_task_work, max(query.plus_words.size(), query.minus_words.size()));
+}
+
+QueryLatencySnapshot SearchServer::GetQueryLatencyStats() const {
+    return query_latency_stats_->GetSnapshot();
+}
+
+void SearchServer::ResetQueryLatencyStats() {
+    query_latency_stats_->Reset();
+}
+
+MemoryStats SearchServer::GetMemoryStats() const {
+    MemoryStats stats;
+    stats.document_texts = memory_counters_->document_texts.GetBytes();
+    stats.documents = memory_counters_->documents.GetBytes();
+    stats.dictionary = memory_counters_->dictionary.GetBytes();
+    stats.postings = memory_counters_->postings.GetBytes();
+    stats.document_words = memory_counters_->document_words.GetBytes();
+    stats.document_ids = memory_counters_->document_ids.GetBytes();
+    stats.stop_words = memory_counters_->stop_words.GetBytes();
+    stats.positions = memory_counters_->positions.GetBytes();
+    stats.term_dictionary = memory_counters_->term_dictionary.GetBytes();
+    stats.rating_index = memory_counters_->rating_index.GetBytes();
+    stats.impact_postings = memory_counters_->impact_postings.GetBytes();
+    return stats;
+}
+
+string SearchServer::MakeQueryKeptPunctuation(const SearchServerOptions& options) {
+    string kept_punctuation(DOCUMENT_KEPT_PUNCTUATION);
+    if (options.positional_index) {
+        kept_punctuation += '"';
+    }
+    if (options.wildcard_query_words) {
+        kept_punctuation += "*?"sv;
+    }
+    // ~ — допуск фразы "..."~N и нечёткое слово word~N
+    if (options.positional_index || options.fuzzy_query_words) {
+        kept_punctuation += '~';
+    }
+    return kept_punctuation;
+}
+
+SearchServer::StopWords SearchServer::MakeStopWords(const TransparentStringSet& stop_words, MemoryCounter& counter, bool normalize_text) {
+    if (!all_of(stop_words.begin(), stop_words.end(), IsValidWord)) {
+        throw invalid_argument("Some of stop words are invalid"s);
+    }
+    StopWords result(&counter);
+    if (!normalize_text) {
+        result.Assign(vector<string_view>(stop_words.begin(), stop_words.end()));
+        return result;
+    }
+    // Стоп-слово может разделиться на несколько слов по знакам препинания
+    TransparentStringSet normalized_words;
+    for (string word : stop_words) {
+        NormalizeText(word, word.data(), DOCUMENT_KEPT_PUNCTUATION);
+        for (const string_view normalized_word : SplitIntoWords(word)) {
+            normalized_words.emplace(normalized_word);
+        }
+    }
+    result.Assign(vector<string_view>(normalized_words.begin(), normalized_words.end()));
+    return result;
+}
+
+SearchServer::DocumentText SearchServer::MakeDocumentText(string_view text) const {
+    const DocumentText::allocator_type allocator(&memory_counters_->document_texts, options_.memory_resource);
+    if (!options_.normalize_text) {
+        return DocumentText(text, allocator);
+    }
+    DocumentText result(text.size(), ' ', allocator);
+    NormalizeText(text, result.data(), DOCUMENT_KEPT_PUNCTUATION);
+    return result;
 }
 
 void SearchServer::RemoveDocument(int document_id) {
@@ -210,14 +911,41 @@ void SearchServer::RemoveDocument(const execution::sequenced_policy&, int docume
         return;
     }
 
-    document_ids_.erase(document_id);
-    documents_.erase(document_id);
-
+    // Слова индекса ссылаются на текст документа, поэтому текст удаляется последним
     for (auto& [word, freq] : document_to_word_freqs_.at(document_id)) {
         word_to_document_freqs_.at(word).erase(document_id);
+        if (options_.impact_ordered_postings) {
+            word_impacts_.at(word).erase({freq, document_id});
+        }
+        ReleaseWordKey(word, document_id);
     }
 
     document_to_word_freqs_.erase(document_id);
+    document_to_word_positions_.erase(document_id);
+    document_ids_.erase(document_id);
+    const DocumentData& document_data = documents_.at(document_id);
+    rating_index_.erase({document_data.rating, document_id});
+    total_word_count_ -= document_data.word_count;
+    documents_.erase(document_id);
+    UpdateTermDictionary();
+}
+
+void SearchServer::RemoveDocument(const AdaptivePolicy&, int document_id) {
+    const auto word_freqs = document_to_word_freqs_.find(document_id);
+    if (word_freqs == document_to_word_freqs_.end()) {
+        return;
+    }
+    // Документ удаляется из списка каждого своего слова, а при списках по term_freq — и из него
+    const size_t erase_cost = options_.impact_ordered_postings ? 2 : 1;
+    const size_t word_count = word_freqs->second.size();
+    const ExecutionPlan plan = GetExecutionPlanner().Plan(word_count * erase_cost, erase_cost, word_count);
+    if (!plan.IsParallel()) {
+        RemoveDocument(execution::seq, document_id);
+        return;
+    }
+    ExecutionPlanner::Execute(plan, [this, document_id] {
+        RemoveDocument(execution::par, document_id);
+    });
 }
 
 void SearchServer::RemoveDocument(const execution::parallel_policy&, int document_id) {
@@ -225,9 +953,6 @@ void SearchServer::RemoveDocument(const execution::parallel_policy&, int documen
         return;
     }
 
-    document_ids_.erase(document_id);
-    documents_.erase(document_id);
-
     const auto& word_freqs = document_to_word_freqs_.at(document_id);
     vector<string_view> words(word_freqs.size());
     transform(
@@ -239,9 +964,22 @@ void SearchServer::RemoveDocument(const execution::parallel_policy&, int documen
     for_each(
         execution::par,
         words.begin(), words.end(),
-        [this, document_id](string_view word) {
+        [this, document_id, &word_freqs](string_view word) {
             word_to_document_freqs_.at(word).erase(document_id);
+            if (options_.impact_ordered_postings) {
+                word_impacts_.at(word).erase({word_freqs.at(word), document_id});
+            }
         });
+    for (const string_view word : words) {
+        ReleaseWordKey(word, document_id);
+    }
 
     document_to_word_freqs_.erase(document_id);
+    document_to_word_positions_.erase(document_id);
+    document_ids_.erase(document_id);
+    const DocumentData& document_data = documents_.at(document_id);
+    rating_index_.erase({document_data.rating, document_id});
+    total_word_count_ -= document_data.word_count;
+    documents_.erase(document_id);
+    UpdateTermDictionary();
 }
@@ -1,9 +1,20 @@
 #include "../include/string_processing.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define STRING_PROCESSING_SSE2
+#endif
+
 using namespace std;
 
-vector<string_view> SplitIntoWords(string_view str) {
-    vector<string_view> result;
+namespace {
+
+template <typename Words>
+void SplitIntoWordsTo(string_view str, Words& result) {
     str.remove_prefix(std::min(str.find_first_not_of(' '), str.size()));
 
     while (!str.empty()) {
@@ -12,6 +23,199 @@ vector<string_view> SplitIntoWords(string_view str) {
         str.remove_prefix(result.back().size());
         str.remove_prefix(std::min(str.find_first_not_of(' '), str.size()));
     }
+}
+
+bool IsAsciiPunctuation(unsigned char c) {
+    return (c >= 0x21 && c <= 0x2F) || (c >= 0x3A && c <= 0x40) || (c >= 0x5B && c <= 0x60) || (c >= 0x7B && c <= 0x7E);
+}
+
+char NormalizeAscii(unsigned char c, string_view kept_punctuation) {
+    if (c >= 'A' && c <= 'Z') {
+        return static_cast<char>(c + ('a' - 'A'));
+    }
+    if (IsAsciiPunctuation(c) && kept_punctuation.find(static_cast<char>(c)) == kept_punctuation.npos) {
+        return ' ';
+    }
+    return static_cast<char>(c);
+}
+
+[[noreturn]] void ThrowInvalidUtf8(size_t offset) {
+    throw invalid_argument("Invalid UTF-8 at byte "s + to_string(offset));
+}
+
+bool IsContinuation(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+// Длина последовательности UTF-8 с байта offset; отвергает лишние байты, суррогаты и значения больше U+10FFFF
+size_t GetSequenceLength(string_view text, size_t offset) {
+    const auto byte = [text](size_t i) {
+        return static_cast<unsigned char>(text[i]);
+    };
+    const unsigned char lead = byte(offset);
+    size_t length = 0;
+    unsigned char min_second = 0x80;
+    unsigned char max_second = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        min_second = lead == 0xE0 ? 0xA0 : 0x80;
+        max_second = lead == 0xED ? 0x9F : 0xBF;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        min_second = lead == 0xF0 ? 0x90 : 0x80;
+        max_second = lead == 0xF4 ? 0x8F : 0xBF;
+    } else {
+        ThrowInvalidUtf8(offset);
+    }
+    if (offset + length > text.size() || byte(offset + 1) < min_second || byte(offset + 1) > max_second) {
+        ThrowInvalidUtf8(offset);
+    }
+    for (size_t i = 2; i < length; ++i) {
+        if (!IsContinuation(byte(offset + i))) {
+            ThrowInvalidUtf8(offset);
+        }
+    }
+    return length;
+}
+
+// Нормализует символ, начинающийся с байта offset, и возвращает смещение следующего
+size_t NormalizeCharacter(string_view text, char* output, size_t offset, string_view kept_punctuation) {
+    const unsigned char lead = static_cast<unsigned char>(text[offset]);
+    if (lead < 0x80) {
+        output[offset] = NormalizeAscii(lead, kept_punctuation);
+        return offset + 1;
+    }
+    const size_t length = GetSequenceLength(text, offset);
+    uint32_t code_point = lead & (0xFF >> (length + 1));
+    for (size_t i = 1; i < length; ++i) {
+        code_point = (code_point << 6) | (static_cast<unsigned char>(text[offset + i]) & 0x3F);
+    }
+    // Пробелы и знаки Latin-1 (U+00A0–U+00BF, кроме букв ª º), а также General Punctuation
+    const bool is_punctuation = (code_point >= 0xA0 && code_point <= 0xBF && code_point != 0xAA && code_point != 0xBA)
+        || code_point == 0xD7 || code_point == 0xF7
+        || (code_point >= 0x2000 && code_point <= 0x206F);
+    if (is_punctuation) {
+        fill(output + offset, output + offset + length, ' ');
+        return offset + length;
+    }
+    // Прописные буквы Latin-1 и кириллицы кодируются тем же числом байт, что и строчные
+    if (code_point >= 0xC0 && code_point <= 0xDE) {
+        code_point += 0x20;
+    } else if (code_point >= 0x400 && code_point <= 0x40F) {
+        code_point += 0x50;
+    } else if (code_point >= 0x410 && code_point <= 0x42F) {
+        code_point += 0x20;
+    }
+    if (length == 2) {
+        output[offset] = static_cast<char>(0xC0 | (code_point >> 6));
+        output[offset + 1] = static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (output != text.data()) {
+        copy(text.begin() + offset, text.begin() + offset + length, output + offset);
+    }
+    return offset + length;
+}
+
+#ifdef STRING_PROCESSING_SSE2
+// 16 байт ASCII за раз: прописные буквы и знаки препинания находятся сравнениями с границами диапазонов
+class AsciiBlockNormalizer {
+public:
+    static constexpr size_t BLOCK_SIZE = 16;
+    static constexpr size_t MAX_KEPT_PUNCTUATION = 8;
+
+    explicit AsciiBlockNormalizer(string_view kept_punctuation)
+        : kept_count_(min(kept_punctuation.size(), MAX_KEPT_PUNCTUATION)) {
+        for (size_t i = 0; i < kept_count_; ++i) {
+            kept_[i] = _mm_set1_epi8(kept_punctuation[i]);
+        }
+    }
+
+    static bool IsSupported(string_view kept_punctuation) {
+        return kept_punctuation.size() <= MAX_KEPT_PUNCTUATION;
+    }
+
+    // false, если в блоке есть байты не из ASCII
+    bool Normalize(const char* input, char* output) const {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+        if (_mm_movemask_epi8(block) != 0) {
+            return false;
+        }
+        const __m128i upper = InRange(block, 'A', 'Z');
+        __m128i punctuation = _mm_or_si128(_mm_or_si128(InRange(block, 0x21, 0x2F), InRange(block, 0x3A, 0x40)),
+                                           _mm_or_si128(InRange(block, 0x5B, 0x60), InRange(block, 0x7B, 0x7E)));
+        for (size_t i = 0; i < kept_count_; ++i) {
+            punctuation = _mm_andnot_si128(_mm_cmpeq_epi8(block, kept_[i]), punctuation);
+        }
+        const __m128i lower = _mm_add_epi8(block, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+        const __m128i result = _mm_or_si128(_mm_andnot_si128(punctuation, lower), _mm_and_si128(punctuation, _mm_set1_epi8(' ')));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output), result);
+        return true;
+    }
+
+private:
+    __m128i kept_[MAX_KEPT_PUNCTUATION];
+    size_t kept_count_;
+
+    // Байты ASCII сравниваются как знаковые без переполнения
+    static __m128i InRange(__m128i block, char first, char last) {
+        return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(static_cast<char>(first - 1))),
+                             _mm_cmplt_epi8(block, _mm_set1_epi8(static_cast<char>(last + 1))));
+    }
+};
+#endif
+
+} // namespace
+
+size_t GetCharacterLength(string_view text, size_t offset) {
+    const auto lead = static_cast<unsigned char>(text[offset]);
+    const size_t length = lead >= 0xF0 && lead <= 0xF4 ? 4
+                        : lead >= 0xE0 && lead <= 0xEF ? 3
+                        : lead >= 0xC2 && lead <= 0xDF ? 2
+                        : 1;
+    if (offset + length > text.size()) {
+        return 1;
+    }
+    for (size_t i = 1; i < length; ++i) {
+        if (!IsContinuation(static_cast<unsigned char>(text[offset + i]))) {
+            return 1;
+        }
+    }
+    return length;
+}
+
+vector<string_view> SplitIntoWords(string_view str) {
+    vector<string_view> result;
+    SplitIntoWordsTo(str, result);
     return result;
 }
 
+pmr::vector<string_view> SplitIntoWords(string_view str, pmr::memory_resource* resource) {
+    pmr::vector<string_view> result(resource);
+    SplitIntoWordsTo(str, result);
+    return result;
+}
+
+void NormalizeText(string_view text, char* output, string_view kept_punctuation) {
+    size_t offset = 0;
+#ifdef STRING_PROCESSING_SSE2
+    if (AsciiBlockNormalizer::IsSupported(kept_punctuation)) {
+        const AsciiBlockNormalizer block_normalizer(kept_punctuation);
+        const size_t block_size = AsciiBlockNormalizer::BLOCK_SIZE;
+        while (offset + block_size <= text.size()) {
+            if (block_normalizer.Normalize(text.data() + offset, output + offset)) {
+                offset += block_size;
+                continue;
+            }
+            // Блок с другими символами обрабатывается посимвольно
+            const size_t block_end = offset + block_size;
+            while (offset < block_end) {
+                offset = NormalizeCharacter(text, output, offset, kept_punctuation);
+            }
+        }
+    }
+#endif
+    while (offset < text.size()) {
+        offset = NormalizeCharacter(text, output, offset, kept_punctuation);
+    }
+}
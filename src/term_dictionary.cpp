@@ -0,0 +1,209 @@
+#include "../include/term_dictionary.h"
+#include "../include/string_processing.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+template <typename Bytes>
+void WriteVarint(Bytes& bytes, size_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+template <typename Bytes>
+size_t ReadVarint(const Bytes& bytes, size_t& offset) {
+    size_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        const uint8_t byte = bytes[offset++];
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+}
+
+} // namespace
+
+TermDictionary::TermDictionary(MemoryCounter* counter)
+    : bytes_(CountingAllocator<uint8_t>(counter))
+    , block_offsets_(CountingAllocator<size_t>(counter)) {
+}
+
+void TermDictionary::Assign(const vector<string_view>& terms) {
+    bytes_.clear();
+    block_offsets_.clear();
+    term_count_ = terms.size();
+    string_view previous;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        const string_view term = terms[i];
+        size_t shared = 0;
+        if (i % BLOCK_SIZE == 0) {
+            block_offsets_.push_back(bytes_.size());
+        } else {
+            const size_t max_shared = min(previous.size(), term.size());
+            while (shared < max_shared && previous[shared] == term[shared]) {
+                ++shared;
+            }
+        }
+        WriteVarint(bytes_, shared);
+        WriteVarint(bytes_, term.size() - shared);
+        bytes_.insert(bytes_.end(), term.begin() + shared, term.end());
+        previous = term;
+    }
+    bytes_.shrink_to_fit();
+    block_offsets_.shrink_to_fit();
+}
+
+size_t TermDictionary::GetTermCount() const {
+    return term_count_;
+}
+
+string_view TermDictionary::GetBlockHead(size_t block) const {
+    size_t offset = block_offsets_[block];
+    ReadVarint(bytes_, offset);
+    const size_t size = ReadVarint(bytes_, offset);
+    return {reinterpret_cast<const char*>(bytes_.data() + offset), size};
+}
+
+TermDictionary::Cursor TermDictionary::LowerBound(string_view target) const {
+    Cursor cursor(this);
+    cursor.Seek(target);
+    return cursor;
+}
+
+vector<string> TermDictionary::FindByPattern(string_view pattern, size_t limit) const {
+    vector<string> terms;
+    const string_view prefix = pattern.substr(0, min(pattern.find_first_of("*?"), pattern.size()));
+    for (Cursor cursor = LowerBound(prefix); cursor.IsValid() && terms.size() < limit; cursor.Next()) {
+        const string_view term = cursor.GetTerm();
+        if (term.substr(0, prefix.size()) != prefix) {
+            break;
+        }
+        if (MatchesPattern(term, pattern)) {
+            terms.emplace_back(term);
+        }
+    }
+    return terms;
+}
+
+TermDictionary::Cursor::Cursor(const TermDictionary* dictionary)
+    : dictionary_(dictionary) {
+    if (IsValid()) {
+        Decode();
+    }
+}
+
+bool TermDictionary::Cursor::IsValid() const {
+    return index_ < dictionary_->term_count_;
+}
+
+string_view TermDictionary::Cursor::GetTerm() const {
+    return term_;
+}
+
+size_t TermDictionary::Cursor::GetSharedPrefix() const {
+    return shared_prefix_;
+}
+
+void TermDictionary::Cursor::Decode() {
+    const size_t stored_shared = ReadVarint(dictionary_->bytes_, offset_);
+    const size_t suffix_size = ReadVarint(dictionary_->bytes_, offset_);
+    const char* suffix = reinterpret_cast<const char*>(dictionary_->bytes_.data() + offset_);
+    offset_ += suffix_size;
+    // Первый терм блока записан целиком, общий префикс с предыдущим считаем сами
+    if (index_ % BLOCK_SIZE == 0) {
+        const string_view term(suffix, suffix_size);
+        const size_t max_shared = min(term_.size(), term.size());
+        shared_prefix_ = 0;
+        while (shared_prefix_ < max_shared && term_[shared_prefix_] == term[shared_prefix_]) {
+            ++shared_prefix_;
+        }
+    } else {
+        shared_prefix_ = stored_shared;
+    }
+    term_.resize(stored_shared);
+    term_.append(suffix, suffix_size);
+}
+
+void TermDictionary::Cursor::Next() {
+    ++index_;
+    if (IsValid()) {
+        Decode();
+    }
+}
+
+void TermDictionary::Cursor::Seek(string_view target) {
+    const auto& block_offsets = dictionary_->block_offsets_;
+    // Ищем последний блок, первый терм которого не больше target
+    size_t left = 0;
+    size_t right = block_offsets.size();
+    const bool is_forward = IsValid() && term_ < target;
+    if (is_forward) {
+        // При обходе словаря цель обычно недалеко впереди: ищем границы поиска галопом от текущего блока
+        left = index_ / BLOCK_SIZE;
+        size_t step = 1;
+        while (left + step < block_offsets.size() && dictionary_->GetBlockHead(left + step) <= target) {
+            left += step;
+            step *= 2;
+        }
+        right = min(left + step, block_offsets.size());
+    }
+    while (right - left > 1) {
+        const size_t middle = left + (right - left) / 2;
+        if (dictionary_->GetBlockHead(middle) <= target) {
+            left = middle;
+        } else {
+            right = middle;
+        }
+    }
+    if (!is_forward || left != index_ / BLOCK_SIZE) {
+        index_ = left * BLOCK_SIZE;
+        offset_ = block_offsets.empty() ? 0 : block_offsets[left];
+        term_.clear();
+        if (!IsValid()) {
+            return;
+        }
+        Decode();
+    }
+    while (IsValid() && term_ < target) {
+        Next();
+    }
+    shared_prefix_ = 0;
+}
+
+bool MatchesPattern(string_view word, string_view pattern) {
+    // Жадное сопоставление с возвратом к последней *. ? и * берут символы UTF-8 целиком,
+    // поэтому позиция в word после них всегда на границе символа.
+    size_t word_pos = 0;
+    size_t pattern_pos = 0;
+    size_t star_pos = pattern.npos;
+    size_t star_word_pos = 0;
+    while (word_pos < word.size()) {
+        if (pattern_pos < pattern.size() && pattern[pattern_pos] == '*') {
+            star_pos = pattern_pos++;
+            star_word_pos = word_pos;
+        } else if (pattern_pos < pattern.size() && pattern[pattern_pos] == '?') {
+            word_pos += GetCharacterLength(word, word_pos);
+            ++pattern_pos;
+        } else if (pattern_pos < pattern.size() && pattern[pattern_pos] == word[word_pos]) {
+            ++word_pos;
+            ++pattern_pos;
+        } else if (star_pos != pattern.npos) {
+            pattern_pos = star_pos + 1;
+            star_word_pos += GetCharacterLength(word, star_word_pos);
+            word_pos = star_word_pos;
+        } else {
+            return false;
+        }
+    }
+    while (pattern_pos < pattern.size() && pattern[pattern_pos] == '*') {
+        ++pattern_pos;
+    }
+    return pattern_pos == pattern.size();
+}
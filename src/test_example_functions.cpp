@@ -1,4 +1,27 @@
 #include "../include/test_example_functions.h"
+#include "../include/allocation_counter.h"
+#include "../include/async_search_server.h"
+#include "../include/concurrent_request_queue.h"
+#include "../include/document_ingestion.h"
+#include "../include/duplicate_detector.h"
+#include "../include/levenshtein_automaton.h"
+#include "../include/load_tester.h"
+#include "../include/paginator.h"
+#include "../include/perfect_hash_set.h"
+#include "../include/perf_counters.h"
+#include "../include/process_queries.h"
+#include "../include/query_context.h"
+#include "../include/string_processing.h"
+#include "../include/term_dictionary.h"
+#include "../include/text_generator.h"
+#include "../include/trace.h"
+#include "../include/write_ahead_log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
 
 using namespace std;
 
@@ -46,9 +69,11 @@ void MatchDocuments(const SearchServer& search_server, string_view query) {
     try {
         cout << "Матчинг документов по запросу: "s << query << endl;
 
-        for (int document_id : search_server) {
-            const auto [words, status] = search_server.MatchDocument(query, document_id);
-            PrintMatchDocumentResult(document_id, words, status);
+        const vector<int> document_ids(search_server.begin(), search_server.end());
+        const auto results = search_server.MatchDocuments(query, document_ids);
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            const auto& [words, status] = results[i];
+            PrintMatchDocumentResult(document_ids[i], words, status);
         }
     } catch (const invalid_argument& e) {
         cout << "Ошибка матчинга документов на запрос "s << query << ": "s << e.what() << endl;
@@ -56,28 +81,10 @@ void MatchDocuments(const SearchServer& search_server, string_view query) {
 }
 
 void RemoveDuplicates(SearchServer& search_server) {
-    std::set<std::set<std::string_view>> existing_docs;
-    std::vector<int> found_duplicates;
-
-    for (int document_id : search_server) {
-        auto& freqs = search_server.GetWordFrequencies(document_id);
-        std::set<std::string_view> words;
-
-        std::transform(freqs.begin(), freqs.end(), std::inserter(words, words.begin()),
-        [](auto p) {
-            return p.first;
-        });
-
-        if (existing_docs.count(words) > 0) {
-            cout << "Found duplicate document id " << document_id << endl;
-            found_duplicates.push_back(document_id);
-        } else {
-            existing_docs.insert(words);
-        }
-    }
-
-    for (int id : found_duplicates) {
-        search_server.RemoveDocument(id);
+    DuplicateDetector detector;
+    for (const DuplicateMatch& duplicate : detector.FindDuplicates(execution::par, search_server)) {
+        cout << "Found duplicate document id " << duplicate.document_id << endl;
+        search_server.RemoveDocument(duplicate.document_id);
     }
 }
 
@@ -452,9 +459,1416 @@ void TestRemoveDocuments(){
     server.RemoveDocument(2);
     ASSERT_EQUAL(server.GetDocumentCount(), 3);
     }
+    // Слово индекса не должно ссылаться на текст удалённого документа, который добавил его первым
+    for (const bool is_parallel : {false, true}) {
+        SearchServer server("и"s);
+        server.AddDocument(1, "робот утилизатор и конвейер"s, DocumentStatus::ACTUAL, {1});
+        server.AddDocument(2, "робот пылесос"s, DocumentStatus::ACTUAL, {2});
+        if (is_parallel) {
+            server.RemoveDocument(execution::par, 1);
+        } else {
+            server.RemoveDocument(1);
+        }
+        // Новый документ может занять освобождённую память текста
+        server.AddDocument(3, "кошка собака и попугай ара"s, DocumentStatus::ACTUAL, {3});
+        const auto documents = server.FindTopDocuments("робот"s);
+        ASSERT_EQUAL(documents.size(), 1u);
+        ASSERT_EQUAL(documents[0].id, 2);
+        const string query = "робот пылесос"s;
+        const auto [words, status] = server.MatchDocument(query, 2);
+        ASSERT_EQUAL(words, vector<string_view>({"пылесос"sv, "робот"sv}));
+        ASSERT_EQUAL(server.GetWordFrequencies(2).count("робот"sv), 1u);
+        server.RemoveDocument(2);
+        ASSERT(server.FindTopDocuments("робот"s).empty());
+    }
+}
+
+
+void TestAddDocuments(){
+    {
+    SearchServer server("и в на"s);
+    const string text1 = "робот утилизатор"s;
+    const string text2 = "и робот пылесос"s;
+    server.AddDocuments(execution::par, {
+        {1, DocumentStatus::ACTUAL, {5, 5}, text1},
+        {2, DocumentStatus::BANNED, {1, 2, 3}, text2},
+    });
+    ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    const auto result = server.FindTopDocuments("пылесос"s, DocumentStatus::BANNED);
+    ASSERT(result.size() == 1 && result[0].id == 2 && result[0].rating == 2);
+    // Слова индекса должны ссылаться на копию текста, а не на текст из пакета
+    ASSERT_EQUAL(server.GetWordFrequencies(2).size(), 2u);
+    ASSERT(server.GetWordFrequencies(2).begin()->first.data() != text2.data() + text2.find("пылесос"s));
+    }
+
+    {
+    SearchServer server(""s);
+    server.AddDocument(1, "кот"s, DocumentStatus::ACTUAL, {1});
+    // Дубликат id и невалидное слово отменяют весь пакет
+    ASSERT_THROWS(server.AddDocuments({{2, DocumentStatus::ACTUAL, {}, "пёс"sv}, {1, DocumentStatus::ACTUAL, {}, "кот"sv}}), invalid_argument);
+    ASSERT_THROWS(server.AddDocuments(execution::par, {{2, DocumentStatus::ACTUAL, {}, "пёс"sv}, {3, DocumentStatus::ACTUAL, {}, "с\x12кворец"sv}}), invalid_argument);
+    ASSERT_EQUAL(server.GetDocumentCount(), 1);
+    }
+}
+
+void TestWriteAheadLog(){
+    const string path = (filesystem::temp_directory_path() / "search_server_test.wal"s).string();
+    remove(path.c_str());
+    {
+        SearchServer server(""s);
+        WriteAheadLog wal(server, path, 2);
+        wal.AddDocument(1, "робот утилизатор"s, DocumentStatus::ACTUAL, {5, 5, 5});
+        wal.AddDocument(2, "беспилотный самолёт"s, DocumentStatus::ACTUAL, {4});
+        ASSERT_EQUAL(wal.GetPendingCount(), 0u);
+        wal.AddDocument(3, "робот пылесос"s, DocumentStatus::IRRELEVANT, {2, 2});
+        wal.RemoveDocument(2);
+        wal.AddDocument(2, "новая посудомойка"s, DocumentStatus::ACTUAL, {3});
+        ASSERT_EQUAL(wal.GetPendingCount(), 1u);
+        // Неуспешная операция не попадает в журнал
+        ASSERT_THROWS(wal.AddDocument(1, "дубликат"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+    }
+    {
+        SearchServer server(""s);
+        ASSERT_EQUAL(WriteAheadLog::Replay(path, server), 5u);
+        ASSERT_EQUAL(server.GetDocumentCount(), 3);
+        ASSERT_EQUAL(server.FindTopDocuments("самолёт"s).size(), 0u);
+        ASSERT_EQUAL(server.FindTopDocuments("посудомойка"s).size(), 1u);
+        ASSERT_EQUAL(server.FindTopDocuments("пылесос"s, DocumentStatus::IRRELEVANT).size(), 1u);
+        ASSERT_EQUAL(server.FindTopDocuments("робот"s)[0].rating, 5);
+    }
+    {
+        // Оборванная последняя запись отбрасывается
+        filesystem::resize_file(path, filesystem::file_size(path) - 3);
+        SearchServer server(""s);
+        ASSERT_EQUAL(WriteAheadLog::Replay(path, server), 4u);
+        ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    }
+    {
+        // Удаление документа из снимка применяется к уже заполненному серверу
+        SearchServer server(""s);
+        server.AddDocument(7, "старый документ"s, DocumentStatus::ACTUAL, {1});
+        {
+            WriteAheadLog wal(server, path);
+            wal.RemoveDocument(7);
+        }
+        SearchServer restored(""s);
+        restored.AddDocument(7, "старый документ"s, DocumentStatus::ACTUAL, {1});
+        WriteAheadLog::Replay(path, restored);
+        ASSERT_EQUAL(restored.FindTopDocuments("старый"s).size(), 0u);
+    }
+    {
+        // Запись с верной контрольной суммой, но без заявленных рейтингов завершает воспроизведение
+        remove(path.c_str());
+        {
+            SearchServer server(""s);
+            WriteAheadLog wal(server, path);
+            wal.AddDocument(1, "кот"s, DocumentStatus::ACTUAL, {1});
+        }
+        string payload;
+        const auto put = [](string& out, auto value) {
+            out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        };
+        put(payload, uint8_t{1});
+        put(payload, int32_t{9});
+        put(payload, uint8_t{0});
+        put(payload, uint32_t{1000});
+        put(payload, int32_t{5});
+        put(payload, uint32_t{3});
+        payload += "dog"s;
+        // FNV-1a, как в журнале
+        uint32_t checksum = 2166136261u;
+        for (const char c : payload) {
+            checksum = (checksum ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        string record;
+        put(record, static_cast<uint32_t>(payload.size()));
+        put(record, checksum);
+        ofstream(path, ios::binary | ios::app) << record << payload;
+
+        SearchServer server(""s);
+        ASSERT_EQUAL(WriteAheadLog::Replay(path, server), 1u);
+        ASSERT_EQUAL(server.GetDocumentCount(), 1);
+        ASSERT(server.FindTopDocuments("dog"s).empty());
+    }
+    remove(path.c_str());
+}
+
+void TestIngestDocuments(){
+    const string path = (filesystem::temp_directory_path() / "search_server_test_corpus"s).string();
+    {
+        ofstream(path) << "1\tACTUAL\t5 5 5\tробот утилизатор\n"s
+                       << "2\tBANNED\t\tбеспилотный самолёт\r\n"s
+                       << "\n"s
+                       << "3\t0\t-1 3\tробот пылесос\n"s;
+        SearchServer server(""s);
+        IngestionOptions options;
+        options.batch_size = 2;
+        options.queue_capacity = 1;
+        const auto stats = IngestDocuments(server, path, options);
+        ASSERT_EQUAL(stats.document_count, 3u);
+        ASSERT_EQUAL(stats.byte_count, filesystem::file_size(path));
+        ASSERT_EQUAL(server.FindTopDocuments("робот"s).size(), 2u);
+        ASSERT_EQUAL(server.FindTopDocuments("самолёт"s, DocumentStatus::BANNED)[0].rating, 0);
+        ASSERT_EQUAL(server.FindTopDocuments("пылесос"s)[0].rating, 1);
+    }
+    {
+        ofstream(path) << R"({"id": 1, "status": "IRRELEVANT", "ratings": [1, 2, 3], "text": "кот \"рыжий\""})" << "\n"s
+                       << R"({"text":"\u0441\u043e\u0431\u0430\u043a\u0430 злая","source":"web","id":2,"ratings":[]})" << "\n"s;
+        SearchServer server(""s);
+        ASSERT_EQUAL(IngestDocuments(server, path).document_count, 2u);
+        ASSERT_EQUAL(server.FindTopDocuments("\"рыжий\""s, DocumentStatus::IRRELEVANT)[0].rating, 2);
+        ASSERT_EQUAL(server.FindTopDocuments("собака"s)[0].id, 2);
+    }
+    {
+        ofstream(path) << "1\tACTUAL\t1\tкот\n"s
+                       << "2\tACTUAL\tкот\n"s;
+        SearchServer server(""s);
+        ASSERT_THROWS(IngestDocuments(server, path), invalid_argument);
+    }
+    remove(path.c_str());
+}
+
+void TestAsyncSearchServer(){
+    SearchServer server("и в на"s);
+    server.AddDocument(1, "робот утилизатор"s, DocumentStatus::ACTUAL, {5, 5, 5});
+    server.AddDocument(2, "беспилотный самолёт"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(3, "робот пылесос"s, DocumentStatus::BANNED, {2, 2});
+    {
+        AsyncSearchServer async_server(server, 2, 4);
+        vector<future<AsyncSearchResult>> results;
+        for (const string& query : {"робот"s, "самолёт"s, "робот пылесос"s, "пылесос"s}) {
+            results.push_back(async_server.FindTopDocumentsAsync(query));
+        }
+        auto banned = async_server.FindTopDocumentsAsync("пылесос"s, DocumentStatus::BANNED);
+        auto invalid = async_server.FindTopDocumentsAsync("--робот"s);
+
+        ASSERT_EQUAL(results[0].get().documents.size(), 1u);
+        ASSERT_EQUAL(results[1].get().documents[0].id, 2);
+        ASSERT_EQUAL(results[2].get().documents.size(), 1u);
+        ASSERT_EQUAL(results[3].get().documents.size(), 0u);
+        ASSERT_EQUAL(banned.get().documents[0].id, 3);
+        ASSERT_THROWS(invalid.get(), invalid_argument);
+    }
+    {
+        // Единственный поток занят, очередь из одного элемента заполнена — новый запрос отклоняется
+        AsyncSearchServer async_server(server, 1, 1);
+        promise<void> started;
+        promise<void> release;
+        shared_future<void> released = release.get_future().share();
+        auto blocked = async_server.FindTopDocumentsAsync("робот"s,
+            [&started, released, is_first = make_shared<bool>(true)](int, DocumentStatus, int) {
+                if (*is_first) {
+                    *is_first = false;
+                    started.set_value();
+                    released.wait();
+                }
+                return true;
+            });
+        started.get_future().wait();
+        auto queued = async_server.TryFindTopDocumentsAsync("самолёт"s);
+        ASSERT(queued.has_value());
+        ASSERT(!async_server.TryFindTopDocumentsAsync("робот"s).has_value());
+        ASSERT_EQUAL(async_server.GetRejectedCount(), 1u);
+        // Запрос в очереди ждёт, пока поток занят, — не меньше этой паузы
+        const auto blocked_time = chrono::milliseconds(50);
+        this_thread::sleep_for(blocked_time);
+        release.set_value();
+
+        ASSERT_EQUAL(blocked.get().documents.size(), 2u);
+        const AsyncSearchResult result = queued->get();
+        ASSERT_EQUAL(result.documents.size(), 1u);
+        ASSERT(result.queue_time >= blocked_time);
+    }
+}
+
+void TestDuplicateDetector(){
+    SearchServer server("и в на"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    // Тот же набор слов в другом порядке и с повторами
+    server.AddDocument(3, "rat nasty and pet funny funny"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(4, "a b c d e f g h i j k l m n o p q r s t"s, DocumentStatus::ACTUAL, {1});
+    // Отличается одним словом из двадцати: сходство Жаккара 19/21
+    server.AddDocument(5, "a b c d e f g h i j k l m n o p q r s u"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(6, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, {1});
+
+    {
+        DuplicateDetector detector;
+        const auto duplicates = detector.FindDuplicates(execution::par, server);
+        ASSERT_EQUAL(duplicates.size(), 1u);
+        ASSERT(duplicates[0].document_id == 3 && duplicates[0].original_id == 1 && duplicates[0].is_exact);
+    }
+    {
+        DuplicateDetector detector(0.7);
+        const auto duplicates = detector.FindDuplicates(execution::seq, server);
+        ASSERT_EQUAL(duplicates.size(), 2u);
+        ASSERT(duplicates[1].document_id == 5 && duplicates[1].original_id == 4 && !duplicates[1].is_exact);
+        ASSERT(duplicates[1].similarity > 0.7 && duplicates[1].similarity < 1.0);
+
+        // Проверка при добавлении документа
+        server.AddDocument(7, "a b c d e f g h i j k l m n o p q r s v"s, DocumentStatus::ACTUAL, {1});
+        DuplicateMatch match;
+        ASSERT(detector.CheckDocument(7, DuplicateDetector::ComputeFingerprint(server.GetWordFrequencies(7)), match));
+        ASSERT_EQUAL(match.original_id, 4);
+
+        detector.RemoveDocument(4);
+        ASSERT(!detector.CheckDocument(7, DuplicateDetector::ComputeFingerprint(server.GetWordFrequencies(7)), match));
+        ASSERT_EQUAL(detector.GetDocumentCount(), 4u);
+    }
+
+    {
+        // Без кандидатов дубликата нет даже при низком пороге
+        DuplicateDetector detector(0.01);
+        DuplicateMatch match;
+        ASSERT(!detector.CheckDocument(4, DuplicateDetector::ComputeFingerprint(server.GetWordFrequencies(4)), match));
+        ASSERT(!detector.CheckDocument(6, DuplicateDetector::ComputeFingerprint(server.GetWordFrequencies(6)), match));
+        ASSERT(detector.CheckDocument(5, DuplicateDetector::ComputeFingerprint(server.GetWordFrequencies(5)), match));
+        ASSERT_EQUAL(match.original_id, 4);
+        ASSERT_THROWS(DuplicateDetector(0.0), invalid_argument);
+        ASSERT_THROWS(DuplicateDetector(-1.0), invalid_argument);
+    }
+
+    RemoveDuplicates(server);
+    ASSERT_EQUAL(server.GetDocumentCount(), 6);
+}
+
+void TestMatchDocuments(){
+    SearchServer server("и в на"s);
+    server.AddDocument(1, "машина беспилотная"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(2, "автомобиль пропал"s, DocumentStatus::BANNED, {4});
+    server.AddDocument(3, "и машина пропала белая"s, DocumentStatus::ACTUAL, {4});
+    // Длинный документ, для которого выгоднее слияние со словарём документа
+    string long_text = "машина пропала"s;
+    for (int i = 0; i < 100; ++i) {
+        long_text += " слово"s + to_string(i);
+    }
+    server.AddDocument(4, long_text, DocumentStatus::ACTUAL, {4});
+
+    const string query = "пропала машина -беспилотная пропал слово42 слово99"s;
+    const vector<int> ids = {1, 2, 3, 4};
+    const auto seq_results = server.MatchDocuments(query, ids);
+    const auto par_results = server.MatchDocuments(execution::par, query, ids);
+    ASSERT_EQUAL(seq_results.size(), 4u);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const auto [words, status] = server.MatchDocument(query, ids[i]);
+        const auto [par_words, par_status] = server.MatchDocument(execution::par, query, ids[i]);
+        ASSERT(seq_results[i] == par_results[i]);
+        ASSERT(get<0>(seq_results[i]) == words && words == par_words);
+        ASSERT(get<1>(seq_results[i]) == status && status == par_status);
+    }
+    ASSERT_EQUAL(get<0>(seq_results[0]).size(), 0u);
+    ASSERT((get<0>(seq_results[1]) == vector{"пропал"sv}));
+    ASSERT(get<1>(seq_results[1]) == DocumentStatus::BANNED);
+    ASSERT((get<0>(seq_results[2]) == vector{"машина"sv, "пропала"sv}));
+    ASSERT((get<0>(seq_results[3]) == vector{"машина"sv, "пропала"sv, "слово42"sv, "слово99"sv}));
+
+    ASSERT_THROWS(server.MatchDocuments(execution::par, query, {1, 5}), out_of_range);
+}
+
+void TestConcurrentRequestQueue(){
+    using namespace std::chrono;
+    SearchServer server("and in at"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(3, "big cat fancy collar "s, DocumentStatus::ACTUAL, {1, 2, 8});
+    {
+        ConcurrentRequestQueue request_queue(server);
+        vector<future<void>> futures;
+        for (int thread_index = 0; thread_index < 4; ++thread_index) {
+            futures.push_back(async(launch::async, [&request_queue, thread_index] {
+                for (int i = 0; i < 250; ++i) {
+                    if (thread_index % 2 == 0) {
+                        request_queue.AddFindRequest(execution::par, "empty request"s);
+                    } else {
+                        request_queue.AddFindRequest(execution::seq, "curly cat"s);
+                    }
+                }
+            }));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+        const auto statistics = request_queue.GetStatistics();
+        ASSERT_EQUAL(statistics.request_count, 1000u);
+        ASSERT_EQUAL(statistics.no_result_count, 500u);
+        ASSERT_EQUAL(request_queue.GetNoResultRequests(), 500);
+        ASSERT_EQUAL(statistics.result_size_counts[0], 500u);
+        ASSERT_EQUAL(statistics.result_size_counts[3], 500u);
+        ASSERT(statistics.latency_p50 <= statistics.latency_p99 && statistics.latency_p99 <= statistics.latency_max);
+    }
+    {
+        // Окно в одну минуту: старые запросы не учитываются
+        ConcurrentRequestQueue request_queue(server, minutes(1), 4);
+        const auto now = ConcurrentRequestQueue::Clock::now();
+        request_queue.RecordRequest(0, microseconds(10), now - minutes(2));
+        request_queue.RecordRequest(0, microseconds(20), now - seconds(30));
+        request_queue.RecordRequest(2, microseconds(30), now - seconds(10));
+        ASSERT_EQUAL(request_queue.GetStatistics(now).request_count, 2u);
+        ASSERT_EQUAL(request_queue.GetStatistics(now).no_result_count, 1u);
+        ASSERT(request_queue.GetStatistics(now).latency_max == microseconds(30));
+        // Буфер на 4 запроса: самые старые вытесняются
+        for (int i = 0; i < 4; ++i) {
+            request_queue.RecordRequest(1, microseconds(1), now);
+        }
+        ASSERT_EQUAL(request_queue.GetStatistics(now).request_count, 4u);
+        ASSERT_EQUAL(request_queue.GetStatistics(now).no_result_count, 0u);
+    }
+}
+
+void TestLatencyHistogram(){
+    using namespace std::chrono;
+    LatencyHistogram histogram;
+    ASSERT_EQUAL(histogram.GetCount(), 0u);
+    ASSERT(histogram.GetPercentile(0.5) == nanoseconds(0));
+
+    // Значения меньше SUB_BUCKET_COUNT хранятся точно
+    for (int i = 1; i <= 10; ++i) {
+        histogram.Record(nanoseconds(i));
+    }
+    ASSERT(histogram.GetPercentile(0.5) == nanoseconds(5));
+    ASSERT(histogram.GetPercentile(1.0) == nanoseconds(10));
+
+    histogram.Reset();
+    for (int i = 1; i <= 1000; ++i) {
+        histogram.Record(microseconds(i));
+    }
+    const auto summary = histogram.GetSummary();
+    ASSERT_EQUAL(summary.count, 1000u);
+    ASSERT(summary.max == microseconds(1000));
+    const auto near = [](nanoseconds value, nanoseconds expected) {
+        return abs(value.count() - expected.count()) <= expected.count() / static_cast<int64_t>(LatencyHistogram::SUB_BUCKET_COUNT);
+    };
+    ASSERT(near(summary.mean, nanoseconds(500500)));
+    ASSERT(near(summary.p50, microseconds(500)));
+    ASSERT(near(summary.p99, microseconds(990)));
+    ASSERT(near(summary.p999, microseconds(999)));
+    ASSERT(summary.p50 <= summary.p99 && summary.p99 <= summary.p999 && summary.p999 <= summary.max);
+}
+
+void TestQueryLatencyStats(){
+    SearchServer server("and in at"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, {1, 2, 3});
+
+    for (int i = 0; i < 3; ++i) {
+        server.FindTopDocuments("curly -dog"s);
+    }
+    server.FindTopDocuments(execution::par, "fancy collar"s);
+    ASSERT_THROWS(server.FindTopDocuments("--cat"s), invalid_argument);
+
+    auto stats = server.GetQueryLatencyStats();
+    for (const QueryStage stage : {QueryStage::PARSE, QueryStage::POSTINGS_SCAN, QueryStage::MINUS_WORDS,
+                                   QueryStage::SORT, QueryStage::RESULT_BUILD}) {
+        ASSERT_EQUAL(stats.Get(QueryExecution::SEQUENTIAL, stage).count, 3u);
+        ASSERT_EQUAL(stats.Get(QueryExecution::PARALLEL, stage).count, 1u);
+    }
+
+    server.ResetQueryLatencyStats();
+    stats = server.GetQueryLatencyStats();
+    ASSERT_EQUAL(stats.Get(QueryExecution::SEQUENTIAL, QueryStage::PARSE).count, 0u);
+}
+void TestTrace(){
+    SearchServer server("and in at"s);
+    ClearTrace();
+    // Выключенная трассировка ничего не записывает
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    ASSERT_EQUAL(GetTraceEventCount(), 0u);
+
+    EnableTracing();
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.FindTopDocuments(execution::par, "curly -dog"s);
+    ProcessQueries(server, {"curly"s, "fancy collar"s});
+    vector<future<void>> futures;
+    for (int i = 0; i < 4; ++i) {
+        futures.push_back(async(launch::async, [] {
+            TRACE_SCOPE("worker \"scope\"");
+        }));
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+    DisableTracing();
+    server.FindTopDocuments("curly"s);
+
+    // AddDocument, FindTopDocuments(par), FindAllDocuments(par) с двумя словами,
+    // ProcessQueries с двумя запросами и их FindTopDocuments, 4 рабочих потока
+    ASSERT_EQUAL(GetTraceEventCount(), 14u);
+    ostringstream output;
+    WriteChromeTrace(output);
+    const string trace = output.str();
+    ASSERT(trace.find("{\"traceEvents\":["s) == 0);
+    ASSERT(trace.find("\"name\":\"AddDocument\""s) != string::npos);
+    ASSERT(trace.find("\"name\":\"FindAllDocuments(par): minus word\""s) != string::npos);
+    ASSERT(trace.find("\"name\":\"worker \\\"scope\\\"\""s) != string::npos);
+    ASSERT(trace.find("\"ph\":\"X\""s) != string::npos);
+
+    ClearTrace();
+    ASSERT_EQUAL(GetTraceEventCount(), 0u);
+}
+void TestPerfCounters(){
+    PerfCounters counters;
+    counters.Start();
+    volatile uint64_t sum = 0;
+    for (uint64_t i = 0; i < 100000; ++i) {
+        sum = sum + i;
+    }
+    const PerfCounterValues values = counters.Stop();
+    ASSERT(values.duration.count() > 0);
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        const auto counter = static_cast<PerfCounter>(i);
+        // Недоступный счётчик не возвращает значений, время измеряется всегда
+        ASSERT(counters.IsAvailable(counter) || !values.Get(counter));
+    }
+    if (values.Get(PerfCounter::INSTRUCTIONS)) {
+        ASSERT(*values.Get(PerfCounter::INSTRUCTIONS) >= 100000);
+    }
+
+    ostringstream output;
+    {
+        LOG_PERF_COUNTERS_STREAM("scope"s, output);
+    }
+    ASSERT(output.str().find("scope: "s) == 0);
+    ASSERT(output.str().find(" us"s) != string::npos);
+}
+void TestTextGenerator(){
+    {
+        // Частота значения убывает с рангом примерно как 1 / k
+        mt19937 generator(1);
+        const ZipfDistribution distribution(100, 1.0);
+        vector<int> counts(100);
+        for (int i = 0; i < 100000; ++i) {
+            ++counts[distribution(generator)];
+        }
+        ASSERT(counts[0] > counts[1] && counts[1] > counts[3] && counts[3] > counts[50]);
+        ASSERT(abs(static_cast<double>(counts[0]) / counts[1] - 2.0) < 0.2);
+    }
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 300;
+    corpus_options.vocabulary_size = 2000;
+    corpus_options.mean_document_length = 20;
+    const GeneratedCorpus corpus = GenerateZipfCorpus(corpus_options);
+    ASSERT_EQUAL(corpus.vocabulary.size(), 2000u);
+    ASSERT_EQUAL(corpus.documents.size(), 300u);
+    ASSERT(GenerateZipfCorpus(corpus_options).documents[7].text == corpus.documents[7].text);
+    set<DocumentStatus> statuses;
+    for (const auto& document : corpus.documents) {
+        statuses.insert(document.status);
+    }
+    ASSERT_EQUAL(statuses.size(), 4u);
+
+    {
+        QueryLogOptions options;
+        options.query_count = 500;
+        options.distinct_query_count = 100;
+        options.min_query_length = 3;
+        options.max_query_length = 3;
+        options.minus_word_rate = 0.5;
+        const auto queries = GenerateQueryLog(corpus.vocabulary, options);
+        ASSERT_EQUAL(queries.size(), 500u);
+        map<string, int> popularity;
+        for (const string& query : queries) {
+            ASSERT_EQUAL(count(query.begin(), query.end(), ' '), 2);
+            ASSERT(query.front() != '-');
+            ++popularity[query];
+        }
+        // Популярные запросы повторяются
+        ASSERT(popularity.size() <= 100);
+        int max_popularity = 0;
+        for (const auto& [query, query_count] : popularity) {
+            max_popularity = max(max_popularity, query_count);
+        }
+        ASSERT(max_popularity > 25);
+    }
+
+    // Корпус, записанный в файл, читается IngestDocuments
+    const string path = (filesystem::temp_directory_path() / "search_server_test_zipf_corpus"s).string();
+    {
+        ofstream output(path);
+        WriteCorpus(output, corpus);
+    }
+    SearchServer server(corpus.vocabulary[0]);
+    ASSERT_EQUAL(IngestDocuments(server, path).document_count, 300u);
+    SearchServer expected_server(corpus.vocabulary[0]);
+    expected_server.AddDocuments(corpus.GetRecords());
+    const string query = corpus.vocabulary[1] + " "s + corpus.vocabulary[5];
+    ASSERT_EQUAL(server.FindTopDocuments(query, DocumentStatus::BANNED).size(),
+                 expected_server.FindTopDocuments(query, DocumentStatus::BANNED).size());
+    remove(path.c_str());
+}
+void TestLoadTester(){
+    {
+        const auto entry = ParseQueryLogEntry("curly cat"sv);
+        ASSERT_EQUAL(entry.query, "curly cat"s);
+        ASSERT(entry.status == DocumentStatus::ACTUAL);
+        ASSERT_EQUAL(entry.top_k, static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    }
+    {
+        const auto entry = ParseQueryLogEntry("curly -dog\tBANNED\t2\r"sv);
+        ASSERT_EQUAL(entry.query, "curly -dog"s);
+        ASSERT(entry.status == DocumentStatus::BANNED);
+        ASSERT_EQUAL(entry.top_k, 2u);
+        ASSERT_EQUAL(ParseQueryLogEntry("cat\t1\t100"sv).top_k, 100u);
+        ASSERT_THROWS(ParseQueryLogEntry("cat\tNEW"sv), invalid_argument);
+        ASSERT_THROWS(ParseQueryLogEntry("cat\tACTUAL\t0"sv), invalid_argument);
+    }
+
+    SearchServer server("and in at"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::BANNED, {1, 2, 3});
+    const vector<QueryLogEntry> query_log = {
+        {"curly cat"s, DocumentStatus::ACTUAL, 1},
+        {"dog"s, DocumentStatus::BANNED, 5},
+        {"--broken"s, DocumentStatus::ACTUAL, 5},
+        {"curly"s, DocumentStatus::ACTUAL, 100},
+    };
+    {
+        LoadTestOptions options;
+        options.concurrency = 4;
+        options.request_count = 400;
+        options.use_parallel_policy = true;
+        const auto report = RunLoadTest(server, query_log, options);
+        ASSERT_EQUAL(report.request_count, 400u);
+        ASSERT_EQUAL(report.error_count, 100u);
+        ASSERT_EQUAL(report.latency.count, 400u);
+        ASSERT(report.GetThroughput() > 0);
+    }
+    {
+        // Открытый цикл: 20 запросов с частотой 1000 в секунду занимают не меньше 19 мс
+        LoadTestOptions options;
+        options.concurrency = 2;
+        options.target_qps = 1000;
+        options.request_count = 20;
+        const auto report = RunLoadTest(server, query_log, options);
+        ASSERT_EQUAL(report.request_count, 20u);
+        ASSERT(report.seconds >= 0.019);
+        ASSERT(report.GetThroughput() <= 1100);
+    }
+    ASSERT_EQUAL(RunLoadTest(server, {}).request_count, 0u);
+}
+void TestFindDocumentsPage(){
+    SearchServer server("and in at"s);
+    // Документы 1 и 2, 3 и 4 совпадают по релевантности и рейтингу — порядок задаёт id
+    server.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(2, "curly dog"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(3, "curly curly parrot"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(4, "curly curly hamster"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(5, "curly"s, DocumentStatus::ACTUAL, {9});
+    server.AddDocument(6, "curly snake with long tail"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(7, "curly fish"s, DocumentStatus::BANNED, {3});
+    server.AddDocument(8, "fancy collar"s, DocumentStatus::ACTUAL, {3});
+
+    const vector<int> expected_ids = {5, 3, 4, 1, 2, 6};
+    const auto get_ids = [](const vector<Document>& documents) {
+        vector<int> ids;
+        for (const Document& document : documents) {
+            ids.push_back(document.id);
+        }
+        return ids;
+    };
+
+    const SearchPage all = server.FindDocumentsPage("curly"s, PageRequest{100});
+    ASSERT_EQUAL(get_ids(all.documents), expected_ids);
+    ASSERT(!all.next_cursor);
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("curly"s)), vector<int>(expected_ids.begin(), expected_ids.begin() + 5));
+
+    // Смещение и курсор дают одинаковые страницы
+    vector<int> by_offset;
+    vector<int> by_cursor;
+    optional<SearchCursor> cursor;
+    for (size_t offset = 0; offset < expected_ids.size(); offset += 4) {
+        const SearchPage offset_page = server.FindDocumentsPage(execution::par, "curly"s, PageRequest{4, offset});
+        const SearchPage cursor_page = server.FindDocumentsPage("curly"s, DocumentStatus::ACTUAL, PageRequest{4, 0, cursor});
+        ASSERT_EQUAL(get_ids(offset_page.documents), get_ids(cursor_page.documents));
+        ASSERT_EQUAL(offset_page.next_cursor.has_value(), offset + 4 < expected_ids.size());
+        for (const Document& document : offset_page.documents) {
+            by_offset.push_back(document.id);
+        }
+        for (const Document& document : cursor_page.documents) {
+            by_cursor.push_back(document.id);
+        }
+        cursor = cursor_page.next_cursor;
+    }
+    ASSERT_EQUAL(by_offset, expected_ids);
+    ASSERT_EQUAL(by_cursor, expected_ids);
+    ASSERT(!cursor);
+
+    const SearchPage skipped = server.FindDocumentsPage("curly"s, PageRequest{2, 1, SearchCursor{all.documents[1].relevance, 1, 3}});
+    ASSERT_EQUAL(get_ids(skipped.documents), vector<int>({1, 2}));
+    ASSERT(server.FindDocumentsPage("curly"s, PageRequest{2, 10}).documents.empty());
+    ASSERT_EQUAL(get_ids(server.FindDocumentsPage("curly"s, DocumentStatus::BANNED, PageRequest{}).documents), vector<int>{7});
+    ASSERT_THROWS(server.FindDocumentsPage("curly"s, PageRequest{0}), invalid_argument);
+    // Без переполнения при предельных размерах страницы и смещения
+    const size_t max_size = numeric_limits<size_t>::max();
+    ASSERT_EQUAL(server.FindDocumentsPage("curly"s, PageRequest{max_size}).documents.size(), all.documents.size());
+    ASSERT(!server.FindDocumentsPage("curly"s, PageRequest{max_size}).next_cursor);
+    ASSERT_EQUAL(server.FindDocumentsPage("curly"s, PageRequest{max_size, 2}).documents.size(), all.documents.size() - 2);
+    ASSERT(server.FindDocumentsPage("curly"s, PageRequest{max_size, max_size}).documents.empty());
+    ASSERT_EQUAL(server.FindDocumentsPage("curly"s, PageRequest{2, max_size - 1}).documents.size(), 0u);
+
+    vector<int> paged_ids;
+    size_t page_count = 0;
+    for (const auto& page : PaginateSearch(server, "curly"s, 4)) {
+        ++page_count;
+        for (const Document& document : page) {
+            paged_ids.push_back(document.id);
+        }
+    }
+    ASSERT_EQUAL(page_count, 2u);
+    ASSERT_EQUAL(paged_ids, expected_ids);
+    const auto empty_pages = PaginateSearch(server, "nothing"s, 4);
+    ASSERT(empty_pages.begin() == empty_pages.end());
+}
+void TestPhraseQueries(){
+    SearchServer server("and in at"s, SearchServerOptions{true});
+    server.AddDocument(1, "curly cat with curly tail"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat curly"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "curly big fluffy cat"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "the cat in hat"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(5, "very very good dog"s, DocumentStatus::ACTUAL, {5});
+
+    const auto find_ids = [&server](const string& query) {
+        vector<int> ids;
+        for (const Document& document : server.FindTopDocuments(query)) {
+            ids.push_back(document.id);
+        }
+        sort(ids.begin(), ids.end());
+        ASSERT_EQUAL(server.FindTopDocuments(execution::par, query).size(), ids.size());
+        return ids;
+    };
+    ASSERT_EQUAL(find_ids("\"curly cat\""s), vector<int>{1});
+    ASSERT_EQUAL(find_ids("\"curly cat\"~2"s), vector<int>({1, 3}));
+    ASSERT_EQUAL(find_ids("\"cat curly\""s), vector<int>{2});
+    // Стоп-слово внутри фразы занимает позицию
+    ASSERT_EQUAL(find_ids("\"cat in hat\""s), vector<int>{4});
+    ASSERT(find_ids("\"cat hat\""s).empty());
+    ASSERT_EQUAL(find_ids("\"cat hat\"~1"s), vector<int>{4});
+    ASSERT_EQUAL(find_ids("\"very very\""s), vector<int>{5});
+    ASSERT(find_ids("\"very very very\""s).empty());
+    ASSERT_EQUAL(find_ids("curly -\"curly tail\""s), vector<int>({2, 3}));
+    ASSERT_EQUAL(find_ids("dog \"curly cat\""s), vector<int>{1});
+    ASSERT(find_ids("\"in at\""s).empty());
+
+    const auto [words, status] = server.MatchDocument("\"curly cat\""s, 1);
+    ASSERT_EQUAL(words, vector<string_view>({"cat"sv, "curly"sv}));
+    ASSERT(get<0>(server.MatchDocument("\"curly cat\""s, 3)).empty());
+    ASSERT(get<0>(server.MatchDocument(execution::par, "\"curly cat\""s, 3)).empty());
+    ASSERT_EQUAL(get<0>(server.MatchDocument(execution::par, "\"curly cat\"~2"s, 3)).size(), 2u);
+
+    for (const string& query : {"\"curly cat"s, "\"\""s, "\"curly cat\"~x"s, "\"curly cat\"~"s, "\"curly -cat\""s}) {
+        ASSERT_THROWS(server.FindTopDocuments(query), invalid_argument);
+    }
+    // Без позиционного индекса кавычки — часть слова
+    SearchServer plain_server("and in at"s);
+    plain_server.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {1});
+    plain_server.AddDocument(2, "\"curly cat\""s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(plain_server.FindTopDocuments("\"curly"s).size(), 1u);
+    ASSERT_EQUAL(plain_server.GetMemoryStats().positions, 0u);
+
+    ASSERT(server.GetMemoryStats().positions > 0);
+    server.RemoveDocument(1);
+    ASSERT(find_ids("\"curly cat\""s).empty());
+    for (const int document_id : {2, 3, 4, 5}) {
+        server.RemoveDocument(execution::par, document_id);
+    }
+    ASSERT_EQUAL(server.GetMemoryStats().positions, 0u);
+}
+void TestNormalizeText(){
+    const auto normalize = [](string_view text, string_view kept_punctuation = {}) {
+        string result(text.size(), '\0');
+        NormalizeText(text, result.data(), kept_punctuation);
+        return result;
+    };
+    ASSERT_EQUAL(normalize("Hello, World!"sv), "hello  world "s);
+    ASSERT_EQUAL(normalize("ПРИВЕТ Ёлка Ѐ"sv), "привет ёлка ѐ"s);
+    ASSERT_EQUAL(normalize("ÀÉÎ×ÿ"sv), "àéî  ÿ"s);
+    ASSERT_EQUAL(normalize("«Кот» — ok"sv), "  кот       ok"s);
+    ASSERT_EQUAL(normalize("-Cat \"dog\"~1 ca*? a.b"sv, "-\"*?~"sv), "-cat \"dog\"~1 ca*? a b"s);
+    ASSERT_EQUAL(normalize("日本 😀"sv), "日本 😀"s);
+
+    // Длинный текст проходит блоки ASCII по 16 байт, короткие части — посимвольную обработку
+    const vector<string> parts{"Abc, DEF-ghi! "s, "«ЁЖ» Кот "s, "0123456789 "s, "XYZ_[x]{y}~ "s, "ÀÉ — Ω "s, "plain ascii words "s};
+    string text;
+    string expected;
+    for (int i = 0; i < 5; ++i) {
+        for (const string& part : parts) {
+            text += part;
+            expected += normalize(part);
+        }
+    }
+    ASSERT_EQUAL(normalize(text), expected);
+    NormalizeText(text, text.data());
+    ASSERT_EQUAL(text, expected);
+
+    for (const string& invalid : {"\xC0\x80"s, "\xED\xA0\x80"s, "\xD0"s, "\xF4\x90\x80\x80"s, "\x80"s, "ok ok ok ok ok ok \xFF"s}) {
+        ASSERT_THROWS(normalize(invalid), invalid_argument);
+    }
+}
+void TestTextNormalization(){
+    SearchServerOptions options;
+    options.positional_index = true;
+    options.normalize_text = true;
+    options.wildcard_query_words = true;
+    SearchServer server("И в"s, options);
+    server.AddDocument(1, "Робот, который УМЕЕТ танцевать!"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "робот-пылесос и «Кот»"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocuments(execution::par, {{3, DocumentStatus::ACTUAL, {3}, "ROBOT vacuum. В доме"sv}});
+    ASSERT_EQUAL(server.GetWordCount(), 9u);
+
+    const auto find_ids = [&server](string_view query) {
+        vector<int> ids;
+        for (const Document& document : server.FindTopDocuments(query)) {
+            ids.push_back(document.id);
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    };
+    ASSERT_EQUAL(find_ids("РОБОТ"sv), vector<int>{1});
+    ASSERT_EQUAL(find_ids("Робот-Пылесос"sv), vector<int>{2});
+    ASSERT_EQUAL(find_ids("кот!"sv), vector<int>{2});
+    ASSERT_EQUAL(find_ids("Robot"sv), vector<int>{3});
+    ASSERT(find_ids("ДОМЕ -Vacuum"sv).empty());
+    ASSERT_EQUAL(find_ids("\"Умеет Танцевать\""sv), vector<int>{1});
+    ASSERT_EQUAL(find_ids("РОБО*"sv), vector<int>({1, 2}));
+    const auto [words, status] = server.MatchDocument("РОБОТ, умеет"sv, 1);
+    ASSERT_EQUAL(words, vector<string_view>({"робот"sv, "умеет"sv}));
+    const auto [par_words, par_status] = server.MatchDocument(execution::par, "Умеет РОБОТ"sv, 1);
+    ASSERT_EQUAL(par_words, vector<string_view>({"робот"sv, "умеет"sv}));
+
+    ASSERT_THROWS(server.AddDocument(4, "bad \xFF"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+    ASSERT_THROWS(server.AddDocuments(execution::par, {{5, DocumentStatus::ACTUAL, {}, "кот"sv}, {6, DocumentStatus::ACTUAL, {}, "\xD0"sv}}), invalid_argument);
+    ASSERT_EQUAL(server.GetDocumentCount(), 3);
+    ASSERT_THROWS(server.FindTopDocuments("\xD0"sv), invalid_argument);
+
+    // Без синтаксиса запроса его знаки — такие же разделители, как в документах
+    SearchServerOptions normalize_options;
+    normalize_options.normalize_text = true;
+    SearchServer normalized_server(""s, normalize_options);
+    normalized_server.AddDocument(1, "Why? \"Quoted\" robot~ cat*"s, DocumentStatus::ACTUAL, {1});
+    for (const string_view query : {"why"sv, "Why?"sv, "\"quoted\""sv, "robot~"sv, "cat*"sv, "-dog \"Quoted\"~2"sv}) {
+        ASSERT_EQUAL(normalized_server.FindTopDocuments(query).size(), 1u);
+    }
+    ASSERT_EQUAL(get<0>(normalized_server.MatchDocument("Why? cat*"sv, 1)), vector<string_view>({"cat"sv, "why"sv}));
+
+    // Без нормализации регистр различается
+    SearchServer plain("и"s);
+    plain.AddDocument(1, "Робот робот"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(plain.GetWordCount(), 2u);
+}
+void TestPerfectHashSet(){
+    vector<string> words;
+    for (int i = 0; i < 300; ++i) {
+        words.push_back("stop"s + to_string(i));
+    }
+    words.push_back("a"s);
+    words.push_back("word longer than sixty three characters to check the length mask of the set"s);
+    MemoryCounter counter;
+    PerfectHashSet set(&counter);
+    set.Assign(vector<string_view>(words.begin(), words.end()));
+    ASSERT_EQUAL(set.GetSize(), words.size());
+    ASSERT(counter.GetBytes() > 0);
+    for (const string& word : words) {
+        ASSERT(set.Contains(word));
+    }
+    for (const string& word : {"stop300"s, "stop"s, "b"s, ""s, "stop1 "s, "Stop1"s,
+                              "word longer than sixty three characters to check the length mask of the sex"s}) {
+        ASSERT(!set.Contains(word));
+    }
+
+    ASSERT(!PerfectHashSet().Contains("a"sv));
+    set.Assign({"in"sv});
+    ASSERT_EQUAL(set.GetSize(), 1u);
+    ASSERT(set.Contains("in"sv));
+    ASSERT(!set.Contains("at"sv));
+    set.Assign({});
+    ASSERT(!set.Contains("in"sv));
+}
+void TestTermDictionary(){
+    vector<string> words;
+    for (int i = 0; i < 100; ++i) {
+        words.push_back("word"s + to_string(i));
+    }
+    words.push_back("robot"s);
+    words.push_back("robotic"s);
+    words.push_back("rope"s);
+    sort(words.begin(), words.end());
+    TermDictionary dictionary;
+    dictionary.Assign(vector<string_view>(words.begin(), words.end()));
+    ASSERT_EQUAL(dictionary.GetTermCount(), words.size());
+
+    vector<string> decoded;
+    string previous;
+    for (auto cursor = dictionary.LowerBound(""sv); cursor.IsValid(); cursor.Next()) {
+        const string_view term = cursor.GetTerm();
+        ASSERT_EQUAL(term.substr(0, cursor.GetSharedPrefix()), string_view(previous).substr(0, cursor.GetSharedPrefix()));
+        decoded.emplace_back(term);
+        previous = string(term);
+    }
+    ASSERT_EQUAL(decoded, words);
+
+    for (const string& word : words) {
+        ASSERT_EQUAL(dictionary.LowerBound(word).GetTerm(), word);
+    }
+    ASSERT_EQUAL(dictionary.LowerBound("roc"sv).GetTerm(), "rope"sv);
+    ASSERT_EQUAL(dictionary.LowerBound("rob"sv).GetTerm(), "robot"sv);
+    ASSERT(!dictionary.LowerBound("zzz"sv).IsValid());
+
+    ASSERT_EQUAL(dictionary.FindByPattern("robo*"sv, 10), vector<string>({"robot"s, "robotic"s}));
+    ASSERT_EQUAL(dictionary.FindByPattern("word9?"sv, 3), vector<string>({"word90"s, "word91"s, "word92"s}));
+    ASSERT_EQUAL(dictionary.FindByPattern("*ic"sv, 10), vector<string>{"robotic"s});
+    ASSERT(dictionary.FindByPattern("x*"sv, 10).empty());
+    ASSERT(TermDictionary().FindByPattern("*"sv, 10).empty());
+
+    ASSERT(MatchesPattern("robotic"sv, "r*t*c"sv));
+    ASSERT(MatchesPattern("a*b"sv, "a*b"sv));
+    ASSERT(MatchesPattern(""sv, "*"sv));
+    ASSERT(!MatchesPattern("robot"sv, "r?t"sv));
+    ASSERT(!MatchesPattern("robot"sv, "*x*"sv));
+    // ? — один символ UTF-8, а не байт
+    ASSERT(MatchesPattern("кот"sv, "к?т"sv));
+    ASSERT(!MatchesPattern("кот"sv, "к??т"sv));
+    ASSERT(MatchesPattern("котёнок"sv, "*?ё*к"sv));
+    ASSERT(MatchesPattern("пёс"sv, "*с"sv));
+    ASSERT(!MatchesPattern("пёс"sv, "??"sv));
+    TermDictionary cyrillic_dictionary;
+    cyrillic_dictionary.Assign({"кит"sv, "код"sv, "кот"sv, "котёнок"sv, "кто"sv});
+    ASSERT_EQUAL(cyrillic_dictionary.FindByPattern("к?т"sv, 10), vector<string>({"кит"s, "кот"s}));
+    ASSERT_EQUAL(cyrillic_dictionary.FindByPattern("ко?"sv, 10), vector<string>({"код"s, "кот"s}));
+    ASSERT_EQUAL(cyrillic_dictionary.FindByPattern("*т?н*"sv, 10), vector<string>{"котёнок"s});
+}
+void TestWildcardQueries(){
+    SearchServerOptions options;
+    options.wildcard_query_words = true;
+    SearchServer server("and in at"s, options);
+    server.AddDocument(1, "robot robotic arm"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "robin bird"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "rope"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "cat"s, DocumentStatus::ACTUAL, {4});
+
+    const auto find_ids = [&server](const string& query) {
+        vector<int> ids;
+        for (const Document& document : server.FindTopDocuments(query)) {
+            ids.push_back(document.id);
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    };
+    ASSERT_EQUAL(find_ids("robo*"s), vector<int>{1});
+    ASSERT_EQUAL(find_ids("rob*"s), vector<int>({1, 2}));
+    ASSERT_EQUAL(find_ids("ro?e"s), vector<int>{3});
+    ASSERT_EQUAL(find_ids("r*t"s), vector<int>{1});
+    ASSERT_EQUAL(find_ids("r* -rob*"s), vector<int>{3});
+    ASSERT(find_ids("dog*"s).empty());
+    const auto [words, status] = server.MatchDocument("robo*"s, 1);
+    ASSERT_EQUAL(words, vector<string_view>({"robot"sv, "robotic"sv}));
+
+    // Словарь перестраивается после изменения набора слов
+    const size_t dictionary_bytes = server.GetMemoryStats().term_dictionary;
+    ASSERT(dictionary_bytes > 0);
+    server.AddDocument(5, "robe"s, DocumentStatus::ACTUAL, {5});
+    ASSERT_EQUAL(find_ids("rob*"s), vector<int>({1, 2, 5}));
+    server.RemoveDocument(1);
+    ASSERT(find_ids("robo*"s).empty());
+
+    SearchServerOptions capped_options = options;
+    capped_options.max_term_expansions = 2;
+    SearchServer capped_server(""s, capped_options);
+    capped_server.AddDocument(1, "alpha beta gamma"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(get<0>(capped_server.MatchDocument("*"s, 1)), vector<string_view>({"alpha"sv, "beta"sv}));
+
+    SearchServerOptions phrase_options = options;
+    phrase_options.positional_index = true;
+    SearchServer phrase_server(""s, phrase_options);
+    ASSERT_THROWS(phrase_server.FindTopDocuments("\"rob* arm\""s), invalid_argument);
+
+    // Без wildcard_query_words * и ? — обычные символы слова
+    SearchServer literal_server(""s);
+    literal_server.AddDocument(1, "why? c* robot"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(literal_server.FindTopDocuments("why?"s).size(), 1u);
+    ASSERT(literal_server.FindTopDocuments("rob*"s).empty());
+    ASSERT_EQUAL(get<0>(literal_server.MatchDocument("c* why? rob*"s, 1)), vector<string_view>({"c*"sv, "why?"sv}));
+    ASSERT_EQUAL(literal_server.GetMemoryStats().term_dictionary, 0u);
+
+    SearchServer cyrillic_server("и в на"s, options);
+    cyrillic_server.AddDocument(1, "кот"s, DocumentStatus::ACTUAL, {1});
+    cyrillic_server.AddDocument(2, "котёнок"s, DocumentStatus::ACTUAL, {2});
+    ASSERT_EQUAL(cyrillic_server.FindTopDocuments("к?т"s).size(), 1u);
+    ASSERT(cyrillic_server.FindTopDocuments("к??т"s).empty());
+    ASSERT_EQUAL(get<0>(cyrillic_server.MatchDocument("кот?но?"s, 2)), vector<string_view>{"котёнок"sv});
+
+    // Сжатый словарь меньше словаря индекса
+    SearchServer large_server(""s, options);
+    for (int i = 0; i < 1000; ++i) {
+        large_server.AddDocument(i, "word"s + to_string(i), DocumentStatus::ACTUAL, {1});
+    }
+    ASSERT_EQUAL(large_server.FindTopDocuments("word99*"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    const MemoryStats memory = large_server.GetMemoryStats();
+    ASSERT(memory.term_dictionary * 4 < memory.dictionary);
+
+    // Часть слов уже слита в основной словарь, удалённые из него слова не занимают места в подстановке
+    SearchServer merged_server(""s, capped_options);
+    for (int i = 0; i < 2000; ++i) {
+        merged_server.AddDocument(i, "word"s + to_string(i), DocumentStatus::ACTUAL, {1});
+    }
+    const auto find_merged_ids = [&merged_server](const string& query) {
+        vector<int> ids;
+        for (const Document& document : merged_server.FindTopDocuments(query)) {
+            ids.push_back(document.id);
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    };
+    merged_server.RemoveDocument(0);
+    merged_server.RemoveDocument(1);
+    ASSERT_EQUAL(find_merged_ids("word*"s), vector<int>({10, 100}));
+    merged_server.AddDocument(0, "word0"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(find_merged_ids("word*"s), vector<int>({0, 10}));
+    ASSERT_EQUAL(find_merged_ids("word199?"s), vector<int>({1990, 1991}));
+}
+void TestLevenshteinAutomaton(){
+    ASSERT_EQUAL(ComputeEditDistance("kitten"sv, "sitting"sv), 3);
+    ASSERT_EQUAL(ComputeEditDistance(""sv, "abc"sv), 3);
+    ASSERT_EQUAL(ComputeEditDistance("abc"sv, "abc"sv), 0);
+
+    mt19937 generator(42);
+    vector<string> words = GenerateDictionary(generator, 3000, 6);
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    TermDictionary dictionary;
+    dictionary.Assign(vector<string_view>(words.begin(), words.end()));
+
+    for (int i = 0; i < 30; ++i) {
+        const string query = GenerateWord(generator, 6);
+        for (int distance = 0; distance <= MAX_FUZZY_EDIT_DISTANCE; ++distance) {
+            vector<pair<int, string>> expected;
+            for (const string& word : words) {
+                const int edit_distance = ComputeEditDistance(query, word);
+                if (edit_distance <= distance) {
+                    expected.push_back({edit_distance, word});
+                }
+            }
+            sort(expected.begin(), expected.end());
+            vector<pair<int, string>> found;
+            for (FuzzyTerm& term : FindFuzzyTerms(dictionary, query, distance, words.size())) {
+                found.push_back({term.distance, move(term.term)});
+            }
+            ASSERT_EQUAL(found.size(), expected.size());
+            ASSERT(found == expected);
+        }
+    }
+    ASSERT_EQUAL(FindFuzzyTerms(dictionary, "abc"sv, 2, 3).size(), 3u);
+    ASSERT_THROWS(LevenshteinAutomaton("abc"sv, -1), invalid_argument);
+
+    // Расстояние считается в символах UTF-8, а не в байтах
+    ASSERT_EQUAL(ComputeEditDistance("роботы"sv, "робот"sv), 1);
+    ASSERT_EQUAL(ComputeEditDistance("кт"sv, "кот"sv), 1);
+    ASSERT_EQUAL(ComputeEditDistance("кот"sv, "кит"sv), 1);
+    ASSERT_EQUAL(ComputeEditDistance("ёж"sv, "еж"sv), 1);
+    TermDictionary cyrillic_dictionary;
+    cyrillic_dictionary.Assign({"кит"sv, "код"sv, "кот"sv, "кто"sv, "работа"sv, "робот"sv, "роботы"sv});
+    vector<string> fuzzy_terms;
+    for (FuzzyTerm& term : FindFuzzyTerms(cyrillic_dictionary, "кт"sv, 1, 10)) {
+        ASSERT_EQUAL(term.distance, 1);
+        fuzzy_terms.push_back(move(term.term));
+    }
+    ASSERT_EQUAL(fuzzy_terms, vector<string>({"кит"s, "кот"s, "кто"s}));
+    ASSERT_EQUAL(FindFuzzyTerms(cyrillic_dictionary, "робот"sv, 1, 10).size(), 2u);
+
+    // Слова из символов разной длины в UTF-8: автомат совпадает с перебором
+    const vector<string> letters = {"a"s, "b"s, "а"s, "б"s, "ё"s, "€"s};
+    uniform_int_distribution<size_t> letter_distribution(0, letters.size() - 1);
+    const auto generate_mixed_word = [&] {
+        string word;
+        for (int length = uniform_int_distribution<int>(1, 5)(generator); length > 0; --length) {
+            word += letters[letter_distribution(generator)];
+        }
+        return word;
+    };
+    vector<string> mixed_words;
+    for (int i = 0; i < 500; ++i) {
+        mixed_words.push_back(generate_mixed_word());
+    }
+    sort(mixed_words.begin(), mixed_words.end());
+    mixed_words.erase(unique(mixed_words.begin(), mixed_words.end()), mixed_words.end());
+    TermDictionary mixed_dictionary;
+    mixed_dictionary.Assign(vector<string_view>(mixed_words.begin(), mixed_words.end()));
+    for (int i = 0; i < 30; ++i) {
+        const string query = generate_mixed_word();
+        for (int distance = 0; distance <= MAX_FUZZY_EDIT_DISTANCE; ++distance) {
+            size_t expected_count = 0;
+            for (const string& word : mixed_words) {
+                expected_count += ComputeEditDistance(query, word) <= distance;
+            }
+            const auto found = FindFuzzyTerms(mixed_dictionary, query, distance, mixed_words.size());
+            ASSERT_EQUAL(found.size(), expected_count);
+            for (const FuzzyTerm& term : found) {
+                ASSERT_EQUAL(term.distance, ComputeEditDistance(query, term.term));
+            }
+        }
+    }
 }
+void TestFuzzyQueries(){
+    SearchServerOptions options;
+    options.wildcard_query_words = true;
+    options.fuzzy_query_words = true;
+    SearchServer server("and in at"s, options);
+    server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cart"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "coat"s, DocumentStatus::ACTUAL, {4});
+
+    const auto find_ids = [&server](const string& query) {
+        vector<int> ids;
+        for (const Document& document : server.FindTopDocuments(query)) {
+            ids.push_back(document.id);
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    };
+    ASSERT_EQUAL(find_ids("cat~1"s), vector<int>({1, 2, 4}));
+    ASSERT_EQUAL(find_ids("cat~"s), vector<int>({1, 2, 4}));
+    ASSERT_EQUAL(find_ids("cat~0"s), vector<int>{1});
+    ASSERT_EQUAL(find_ids("dgo~2"s), vector<int>{3});
+    ASSERT(find_ids("dgo~1"s).empty());
+    ASSERT_EQUAL(find_ids("dog cart -cat~1"s), vector<int>{3});
+    ASSERT_EQUAL(get<0>(server.MatchDocument("cta~2"s, 1)), vector<string_view>{"cat"sv});
+    ASSERT_THROWS(server.FindTopDocuments("cat~3"s), invalid_argument);
+    ASSERT_THROWS(server.FindTopDocuments("ca*~1"s), invalid_argument);
+
+    SearchServerOptions capped_options = options;
+    capped_options.max_term_expansions = 1;
+    SearchServer capped_server(""s, capped_options);
+    capped_server.AddDocument(1, "cat cart"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(get<0>(capped_server.MatchDocument("cat~1"s, 1)), vector<string_view>{"cat"sv});
+
+    // Без fuzzy_query_words ~N — часть слова
+    SearchServer literal_server(""s);
+    literal_server.AddDocument(1, "c++~2 cart"s, DocumentStatus::ACTUAL, {1});
+    literal_server.AddDocument(2, "c++"s, DocumentStatus::ACTUAL, {2});
+    const auto literal_documents = literal_server.FindTopDocuments("c++~2"s);
+    ASSERT_EQUAL(literal_documents.size(), 1u);
+    ASSERT_EQUAL(literal_documents[0].id, 1);
+    ASSERT(literal_server.FindTopDocuments("cat~1"s).empty());
+    ASSERT_EQUAL(get<0>(literal_server.MatchDocument("c++~2 cat~3"s, 1)), vector<string_view>{"c++~2"sv});
+
+    // Опечатка в одну букву кириллицы — расстояние 1
+    SearchServer cyrillic_server("и в на"s, options);
+    cyrillic_server.AddDocument(1, "роботы"s, DocumentStatus::ACTUAL, {1});
+    cyrillic_server.AddDocument(2, "кот"s, DocumentStatus::ACTUAL, {2});
+    cyrillic_server.AddDocument(3, "пёс"s, DocumentStatus::ACTUAL, {3});
+    const auto find_cyrillic_ids = [&cyrillic_server](const string& query) {
+        vector<int> ids;
+        for (const Document& document : cyrillic_server.FindTopDocuments(query)) {
+            ids.push_back(document.id);
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    };
+    ASSERT_EQUAL(find_cyrillic_ids("робот~1"s), vector<int>{1});
+    ASSERT_EQUAL(find_cyrillic_ids("кт~1"s), vector<int>{2});
+    ASSERT_EQUAL(find_cyrillic_ids("пес~1 кит~1"s), vector<int>({2, 3}));
+    ASSERT(find_cyrillic_ids("рбт~1"s).empty());
+}
+void TestScoringPolicies(){
+    SearchServer server("and in at"s);
+    server.AddDocument(1, "cat cat cat dog"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat bird"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "dog bird fish"s, DocumentStatus::ACTUAL, {3});
+
+    const auto tf_idf = server.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(tf_idf.size(), 2u);
+    ASSERT(abs(tf_idf[0].relevance - 0.75 * log(1.5)) < 1e-6);
+    const auto explicit_tf_idf = server.FindTopDocuments<TfIdfScoring>("cat"s);
+    ASSERT_EQUAL(explicit_tf_idf.size(), tf_idf.size());
+    ASSERT_EQUAL(explicit_tf_idf[0].relevance, tf_idf[0].relevance);
+
+    // N = 3, средняя длина 3: idf = ln(1 + (3 - 2 + 0.5) / (2 + 0.5))
+    const auto bm25 = [](double count, double length, double average_length, double document_count, double word_document_count) {
+        const double idf = log(1.0 + (document_count - word_document_count + 0.5) / (word_document_count + 0.5));
+        const double norm = Bm25Scoring::K1 * (1.0 - Bm25Scoring::B + Bm25Scoring::B * length / average_length);
+        return idf * count * (Bm25Scoring::K1 + 1.0) / (count + norm);
+    };
+    const auto documents = server.FindTopDocuments<Bm25Scoring>("cat"s);
+    ASSERT_EQUAL(documents.size(), 2u);
+    ASSERT_EQUAL(documents[0].id, 1);
+    ASSERT(abs(documents[0].relevance - bm25(3, 4, 3, 3, 2)) < 1e-6);
+    ASSERT(abs(documents[1].relevance - bm25(1, 2, 3, 3, 2)) < 1e-6);
+    const auto par_documents = server.FindTopDocuments<Bm25Scoring>(execution::par, "cat"s);
+    ASSERT_EQUAL(par_documents.size(), documents.size());
+    ASSERT(abs(par_documents[0].relevance - documents[0].relevance) < 1e-6);
+    const SearchPage page = server.FindDocumentsPage<Bm25Scoring>("cat"s, PageRequest{1});
+    ASSERT_EQUAL(page.documents.size(), 1u);
+    ASSERT_EQUAL(page.documents[0].id, 1);
+
+    // Все найденные документы равны, порядок задаёт рейтинг
+    const auto filtered = server.FindTopDocuments<ConstantScoring>("cat dog"s);
+    ASSERT_EQUAL(filtered.size(), 3u);
+    for (const Document& document : filtered) {
+        ASSERT_EQUAL(document.relevance, 1.0);
+    }
+    ASSERT_EQUAL(filtered[0].id, 3);
+    ASSERT_EQUAL(filtered[2].id, 1);
+
+    // Длины удалённых документов не учитываются в средней длине
+    server.RemoveDocument(3);
+    const auto after_remove = server.FindTopDocuments<Bm25Scoring>("cat"s);
+    ASSERT(abs(after_remove[1].relevance - bm25(1, 2, 3, 2, 2)) < 1e-6);
+}
+void TestRatingRangeFilter(){
+    SearchServer server("and in at"s, SearchServerOptions{true});
+    for (int id = 0; id < 200; ++id) {
+        const string text = id % 2 == 0 ? "curly cat"s : "curly dog"s;
+        server.AddDocument(id, text, id % 3 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, {id});
+    }
+    const auto get_ids = [](const vector<Document>& documents) {
+        vector<int> ids;
+        for (const Document& document : documents) {
+            ids.push_back(document.id);
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    };
+    const auto find_with_predicate = [&server, &get_ids](const string& query, RatingRange ratings, DocumentStatus status) {
+        return get_ids(server.FindTopDocuments(query, [ratings, status](int, DocumentStatus document_status, int rating) {
+            return document_status == status && ratings.Contains(rating);
+        }));
+    };
+
+    // Узкий диапазон: документы диапазона ищутся в списках слов
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("curly cat"s, RatingRange{10, 12})), vector<int>({10, 11}));
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments(execution::par, "curly cat"s, RatingRange{10, 12})), vector<int>({10, 11}));
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("cat"s, RatingRange{10, 12}, DocumentStatus::BANNED)), vector<int>{12});
+    // Широкий диапазон: списки обходятся целиком
+    for (const RatingRange& ratings : {RatingRange{50, 199}, RatingRange{}, RatingRange{-5, 3}}) {
+        ASSERT_EQUAL(get_ids(server.FindTopDocuments("curly -dog"s, ratings)), find_with_predicate("curly -dog"s, ratings, DocumentStatus::ACTUAL));
+        ASSERT_EQUAL(get_ids(server.FindTopDocuments(execution::par, "curly"s, ratings, DocumentStatus::BANNED)),
+                     find_with_predicate("curly"s, ratings, DocumentStatus::BANNED));
+    }
+    ASSERT(server.FindTopDocuments("curly"s, RatingRange{12, 10}).empty());
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("\"curly cat\""s, RatingRange{10, 12})), vector<int>{10});
+
+    server.RemoveDocument(10);
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("curly"s, RatingRange{10, 12})), vector<int>{11});
+    const auto documents = server.FindTopDocuments<Bm25Scoring>("curly cat"s, RatingRange{10, 14});
+    ASSERT_EQUAL(documents.size(), 3u);
+    ASSERT_EQUAL(documents[0].id, 14);
+}
+void TestImpactOrderedPostings(){
+    SearchServerOptions impact_options;
+    impact_options.impact_ordered_postings = true;
+    SearchServer server("and in at"s, impact_options);
+    SearchServer reference("and in at"s);
+    const vector<string> words{"cat"s, "dog"s, "curly"s, "tail"s, "collar"s, "and"s};
+    mt19937 generator(42);
+    const auto add_documents = [&](int first_id, int last_id) {
+        for (int id = first_id; id < last_id; ++id) {
+            string text;
+            const int word_count = uniform_int_distribution<int>(1, 8)(generator);
+            for (int i = 0; i < word_count; ++i) {
+                text += words[uniform_int_distribution<size_t>(0, words.size() - 1)(generator)] + " "s;
+            }
+            const DocumentStatus status = id % 4 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+            const vector<int> ratings{uniform_int_distribution<int>(-3, 3)(generator)};
+            server.AddDocument(id, text, status, ratings);
+            reference.AddDocument(id, text, status, ratings);
+        }
+    };
+    const auto assert_same = [](const vector<Document>& lhs, const vector<Document>& rhs) {
+        ASSERT_EQUAL(lhs.size(), rhs.size());
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            ASSERT_EQUAL(lhs[i].id, rhs[i].id);
+            ASSERT(abs(lhs[i].relevance - rhs[i].relevance) < 1e-9);
+        }
+    };
+    const auto check_queries = [&] {
+        for (const string& query : {"cat"s, "curly"s, "collar"s, "missing"s, "cat dog"s, "cat -dog"s}) {
+            assert_same(server.FindTopDocuments(query), reference.FindTopDocuments(query));
+            assert_same(server.FindTopDocuments(execution::par, query, DocumentStatus::BANNED),
+                        reference.FindTopDocuments(execution::par, query, DocumentStatus::BANNED));
+            const auto is_positive = [](int, DocumentStatus, int rating) { return rating > 0; };
+            assert_same(server.FindTopDocuments(query, is_positive), reference.FindTopDocuments(query, is_positive));
+            // Постраничный обход по курсору
+            PageRequest request{7};
+            for (int page_index = 0; page_index < 3; ++page_index) {
+                const SearchPage page = server.FindDocumentsPage(query, request);
+                assert_same(page.documents, reference.FindDocumentsPage(query, request).documents);
+                if (!page.next_cursor) {
+                    break;
+                }
+                request.after = page.next_cursor;
+            }
+        }
+    };
+
+    add_documents(0, 300);
+    ASSERT(server.GetMemoryStats().impact_postings > 0);
+    ASSERT_EQUAL(reference.GetMemoryStats().impact_postings, 0u);
+    check_queries();
+    for (int id = 0; id < 300; id += 3) {
+        server.RemoveDocument(id);
+        reference.RemoveDocument(id);
+    }
+    for (int id = 1; id < 300; id += 3) {
+        server.RemoveDocument(execution::par, id);
+        reference.RemoveDocument(execution::par, id);
+    }
+    check_queries();
+    add_documents(300, 400);
+    check_queries();
 
+    for (int id = 0; id < 400; ++id) {
+        server.RemoveDocument(id);
+    }
+    ASSERT_EQUAL(server.GetMemoryStats().impact_postings, 0u);
+}
+// Источник памяти поверх new/delete, считающий занятые байты
+class TrackingMemoryResource : public pmr::memory_resource {
+public:
+    size_t GetAllocationCount() const {
+        return allocation_count_;
+    }
 
+    size_t GetBytes() const {
+        return bytes_;
+    }
+
+private:
+    atomic<size_t> allocation_count_{0};
+    atomic<size_t> bytes_{0};
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++allocation_count_;
+        bytes_ += bytes;
+        return pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        bytes_ -= bytes;
+        pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+void TestMemoryResource(){
+    TrackingMemoryResource resource;
+    SearchServerOptions options;
+    options.positional_index = true;
+    options.impact_ordered_postings = true;
+    options.memory_resource = &resource;
+    SearchServer server("and in at"s, options);
+    SearchServer reference("and in at"s);
+    const vector<string> texts{"curly cat curly tail"s, "curly dog and a rather long fancy collar"s, "big cat fancy collar"s};
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        reference.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    }
+    ASSERT(resource.GetAllocationCount() > 0);
+    ASSERT(resource.GetBytes() > 0);
+    for (const string& query : {"curly -dog"s, "fancy collar"s, "cat"s}) {
+        const auto documents = server.FindTopDocuments(execution::par, query);
+        const auto expected = reference.FindTopDocuments(execution::par, query);
+        ASSERT_EQUAL(documents.size(), expected.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            ASSERT_EQUAL(documents[i].id, expected[i].id);
+        }
+    }
+
+    // Вся память индекса возвращается источнику
+    server.RemoveDocument(0);
+    server.RemoveDocument(execution::par, 1);
+    server.RemoveDocument(2);
+    ASSERT_EQUAL(resource.GetBytes(), 0u);
+
+    // Индекс без удалений можно строить в монотонном буфере
+    pmr::monotonic_buffer_resource arena;
+    SearchServerOptions arena_options;
+    arena_options.memory_resource = &arena;
+    SearchServer arena_server("and in at"s, arena_options);
+    arena_server.AddDocuments({{1, DocumentStatus::ACTUAL, {1}, "curly cat"sv}, {2, DocumentStatus::ACTUAL, {2}, "curly dog"sv}});
+    ASSERT_EQUAL(arena_server.FindTopDocuments("curly"s).size(), 2u);
+}
+void TestQueryContext(){
+    SearchServerOptions options;
+    options.impact_ordered_postings = true;
+    SearchServer server("and in at"s, options);
+    const vector<string> texts{"curly cat curly tail"s, "curly dog and a rather long fancy collar"s, "big cat fancy collar"s, "fancy dog"s};
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    }
+    const vector<string> queries{"curly -dog"s, "fancy collar cat"s, "cat"s, "dog -big"s};
+    const auto run_queries = [&server, &queries] {
+        for (const string& query : queries) {
+            QueryContext::GetCurrent().Recycle(server.FindTopDocuments(query));
+            QueryContext::GetCurrent().Recycle(server.FindTopDocuments(execution::par, query));
+            QueryContext::GetCurrent().Recycle(server.FindTopDocuments(query, RatingRange{1, 2}));
+        }
+    };
+
+    // После первых запросов контекст потока уже содержит всю нужную память
+    run_queries();
+    const size_t warm_start = GetAllocationCount();
+    run_queries();
+    // Счётчик читается до ASSERT_EQUAL: макрос сам выделяет память под строки
+    const size_t warm_allocations = GetAllocationCount() - warm_start;
+    ASSERT_EQUAL(warm_allocations, 0u);
+
+    // Буфер контекста вырастает до размера запроса
+    QueryContext context(64);
+    {
+        QueryContextScope scope(context);
+        ASSERT_EQUAL(&QueryContext::GetCurrent(), &context);
+        const string long_query = "curly fancy collar cat dog tail"s;
+        context.Recycle(server.FindTopDocuments(long_query));
+        ASSERT(context.GetArenaBytes() > 64);
+        const size_t arena_bytes = context.GetArenaBytes();
+        const size_t start = GetAllocationCount();
+        const auto documents = server.FindTopDocuments(long_query);
+        const size_t allocations = GetAllocationCount() - start;
+        ASSERT_EQUAL(allocations, 0u);
+        ASSERT_EQUAL(documents.size(), 4u);
+        ASSERT_EQUAL(context.GetArenaBytes(), arena_bytes);
+    }
+    ASSERT(&QueryContext::GetCurrent() != &context);
+
+    // Запрос из предиката другого запроса получает временную память
+    const auto documents = server.FindTopDocuments("fancy"s, [&server](int document_id, DocumentStatus, int) {
+        const auto nested = server.FindTopDocuments("curly"s);
+        return any_of(nested.begin(), nested.end(), [document_id](const Document& document) {
+            return document.id == document_id;
+        });
+    });
+    ASSERT_EQUAL(documents.size(), 1u);
+    ASSERT_EQUAL(documents[0].id, 1);
+}
+void TestMemoryStats(){
+    SearchServer server("and in at with a long stop word that does not fit into a short string"s);
+    const MemoryStats empty = server.GetMemoryStats();
+    ASSERT(empty.stop_words > 0);
+    ASSERT_EQUAL(empty.GetIndexBytes(), 0u);
+    ASSERT_EQUAL(empty.GetTotalBytes(), empty.stop_words);
+
+    server.AddDocument(1, "curly cat curly tail with a rather long description of the cat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    const MemoryStats filled = server.GetMemoryStats();
+    ASSERT(filled.document_texts > 0);
+    ASSERT(filled.documents > 0);
+    ASSERT(filled.dictionary > 0);
+    ASSERT(filled.postings > 0);
+    ASSERT(filled.document_words > 0);
+    ASSERT(filled.document_ids > 0);
+    ASSERT_EQUAL(filled.stop_words, empty.stop_words);
+    ASSERT_EQUAL(filled.GetIndexBytes(), filled.dictionary + filled.postings);
+
+    // Удаление возвращает всю память, а перемещение сервера не сбивает счётчики
+    server.RemoveDocument(1);
+    server.RemoveDocument(execution::par, 2);
+    ASSERT_EQUAL(server.GetMemoryStats().GetTotalBytes(), empty.GetTotalBytes());
+    SearchServer moved = move(server);
+    moved.AddDocument(3, "curly cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT(moved.GetMemoryStats().GetIndexBytes() > 0);
+}
 
 void RunConcurrentUpdates(ConcurrentMap<int, int>& cm, size_t thread_count, int key_count) {
     auto kernel = [&cm, key_count](int seed) {
@@ -475,6 +1889,86 @@ void RunConcurrentUpdates(ConcurrentMap<int, int>& cm, size_t thread_count, int
     }
 }
 
+void TestExecutionPlanner(){
+    ExecutionCosts costs;
+    costs.sequential_item_ns = 10.0;
+    costs.parallel_item_ns = 20.0;
+    costs.parallel_dispatch_ns = 1000.0;
+    costs.max_parallelism = 8;
+    const ExecutionPlanner planner(costs);
+    // Запуск потоков не окупается на малой работе
+    ASSERT_EQUAL(planner.Plan(100, 10, 10).parallelism, size_t{1});
+    ASSERT_EQUAL(planner.Plan(1'000'000, 1'000, 1'000).parallelism, size_t{8});
+    // Потоков не больше, чем частей работы, а самая большая часть выполняется одним потоком
+    ASSERT_EQUAL(planner.Plan(1'000'000, 100, 3).parallelism, size_t{3});
+    ASSERT_EQUAL(planner.Plan(1'000'000, 500'000, 2).parallelism, size_t{1});
+    ASSERT_EQUAL(planner.Plan(1'000'000, 1'000'000, 8).parallelism, size_t{1});
+    costs.max_parallelism = 1;
+    ASSERT_EQUAL(ExecutionPlanner(costs).Plan(1'000'000, 1'000, 1'000).parallelism, size_t{1});
+
+    const ExecutionCosts calibrated = ExecutionPlanner::Calibrate();
+    ASSERT(calibrated.sequential_item_ns > 0.0);
+    ASSERT(calibrated.parallel_item_ns > 0.0);
+    ASSERT(calibrated.parallel_dispatch_ns > 0.0);
+    ASSERT(calibrated.max_parallelism >= 1);
+    ASSERT(&ExecutionPlanner::GetCalibrated() == &ExecutionPlanner::GetCalibrated());
+
+    int call_count = 0;
+    ExecutionPlanner::Execute(ExecutionPlan{}, [&call_count] {
+        ++call_count;
+    });
+    ExecutionPlanner::Execute(ExecutionPlan{2}, [&call_count] {
+        const vector<int> values(100, 1);
+        call_count += reduce(execution::par, values.begin(), values.end());
+    });
+    ASSERT_EQUAL(call_count, 101);
+}
+void TestAdaptiveExecution(){
+    // Планировщик, всегда выбирающий параллельное исполнение, и планировщик без параллельного
+    ExecutionCosts parallel_costs;
+    parallel_costs.sequential_item_ns = 1000.0;
+    parallel_costs.parallel_item_ns = 1.0;
+    parallel_costs.parallel_dispatch_ns = 0.0;
+    parallel_costs.max_parallelism = 4;
+    ExecutionCosts sequential_costs;
+    sequential_costs.max_parallelism = 1;
+
+    for (const ExecutionCosts& costs : {parallel_costs, sequential_costs}) {
+        const ExecutionPlanner planner(costs);
+        SearchServerOptions options;
+        options.execution_planner = &planner;
+        SearchServer server("and in"s, options);
+        server.AddDocument(1, "curly cat and fancy collar"s, DocumentStatus::ACTUAL, {1});
+        server.AddDocument(2, "curly dog in the park"s, DocumentStatus::ACTUAL, {2});
+        server.AddDocument(3, "white cat with a collar"s, DocumentStatus::ACTUAL, {3});
+        server.AddDocument(4, "big dog"s, DocumentStatus::ACTUAL, {4});
+
+        const auto adaptive_documents = server.FindTopDocuments(adaptive_policy, "curly cat -collar"s);
+        const auto sequential_documents = server.FindTopDocuments(execution::seq, "curly cat -collar"s);
+        ASSERT_EQUAL(adaptive_documents.size(), sequential_documents.size());
+        for (size_t i = 0; i < adaptive_documents.size(); ++i) {
+            ASSERT_EQUAL(adaptive_documents[i].id, sequential_documents[i].id);
+            ASSERT(abs(adaptive_documents[i].relevance - sequential_documents[i].relevance) < 1e-6);
+        }
+        const auto stats = server.GetQueryLatencyStats();
+        // Все этапы адаптивного запроса записаны под выбранным исполнением, последовательного — под SEQUENTIAL
+        const size_t parallel_count = costs.max_parallelism > 1 ? 1 : 0;
+        for (const QueryStage stage : {QueryStage::PARSE, QueryStage::POSTINGS_SCAN, QueryStage::SORT}) {
+            ASSERT_EQUAL(stats.Get(QueryExecution::PARALLEL, stage).count, parallel_count);
+            ASSERT_EQUAL(stats.Get(QueryExecution::SEQUENTIAL, stage).count, 2 - parallel_count);
+        }
+
+        const auto [words, status] = server.MatchDocument(adaptive_policy, "fancy cat -dog"s, 1);
+        ASSERT_EQUAL(words, vector<string_view>({"cat"sv, "fancy"sv}));
+        ASSERT_THROWS(server.MatchDocument(adaptive_policy, "--cat"s, 1), invalid_argument);
+
+        server.RemoveDocument(adaptive_policy, 1);
+        server.RemoveDocument(adaptive_policy, 10);
+        ASSERT_EQUAL(server.GetDocumentCount(), 3);
+        ASSERT(server.FindTopDocuments(adaptive_policy, "fancy"s).empty());
+        ASSERT_EQUAL(server.FindTopDocuments(adaptive_policy, "curly collar"s).size(), size_t{2});
+    }
+}
 void TestConcurrentUpdate() {
     constexpr size_t THREAD_COUNT = 3;
     constexpr size_t KEY_COUNT = 50000;
@@ -549,6 +2043,36 @@ void TestSearchServer() {
     RUN_TEST(tr, TestMatchDocument);
     RUN_TEST(tr, TestSortRelevance);
     RUN_TEST(tr, TestRemoveDocuments);
+    RUN_TEST(tr, TestAddDocuments);
+    RUN_TEST(tr, TestWriteAheadLog);
+    RUN_TEST(tr, TestIngestDocuments);
+    RUN_TEST(tr, TestAsyncSearchServer);
+    RUN_TEST(tr, TestDuplicateDetector);
+    RUN_TEST(tr, TestMatchDocuments);
+    RUN_TEST(tr, TestConcurrentRequestQueue);
+    RUN_TEST(tr, TestLatencyHistogram);
+    RUN_TEST(tr, TestQueryLatencyStats);
+    RUN_TEST(tr, TestTrace);
+    RUN_TEST(tr, TestPerfCounters);
+    RUN_TEST(tr, TestTextGenerator);
+    RUN_TEST(tr, TestLoadTester);
+    RUN_TEST(tr, TestMemoryStats);
+    RUN_TEST(tr, TestFindDocumentsPage);
+    RUN_TEST(tr, TestPhraseQueries);
+    RUN_TEST(tr, TestTermDictionary);
+    RUN_TEST(tr, TestPerfectHashSet);
+    RUN_TEST(tr, TestNormalizeText);
+    RUN_TEST(tr, TestTextNormalization);
+    RUN_TEST(tr, TestExecutionPlanner);
+    RUN_TEST(tr, TestAdaptiveExecution);
+    RUN_TEST(tr, TestWildcardQueries);
+    RUN_TEST(tr, TestLevenshteinAutomaton);
+    RUN_TEST(tr, TestFuzzyQueries);
+    RUN_TEST(tr, TestScoringPolicies);
+    RUN_TEST(tr, TestRatingRangeFilter);
+    RUN_TEST(tr, TestImpactOrderedPostings);
+    RUN_TEST(tr, TestMemoryResource);
+    RUN_TEST(tr, TestQueryContext);
     //RUN_TEST(TestGetDocumentId);
 }
 
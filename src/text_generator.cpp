@@ -0,0 +1,171 @@
+#include "../include/text_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_set>
+
+using namespace std;
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+    }
+    return queries;
+}
+
+ZipfDistribution::ZipfDistribution(size_t n, double exponent) {
+    if (n == 0) {
+        throw invalid_argument("Zipf distribution needs at least one value"s);
+    }
+    cdf_.reserve(n);
+    double sum = 0;
+    for (size_t k = 1; k <= n; ++k) {
+        sum += 1.0 / pow(static_cast<double>(k), exponent);
+        cdf_.push_back(sum);
+    }
+    for (double& value : cdf_) {
+        value /= sum;
+    }
+}
+
+size_t ZipfDistribution::operator()(mt19937& generator) const {
+    const double value = uniform_real_distribution<>(0, 1)(generator);
+    const auto it = upper_bound(cdf_.begin(), cdf_.end(), value);
+    return min(static_cast<size_t>(it - cdf_.begin()), cdf_.size() - 1);
+}
+
+vector<DocumentRecord> GeneratedCorpus::GetRecords() const {
+    vector<DocumentRecord> records;
+    records.reserve(documents.size());
+    for (const GeneratedDocument& document : documents) {
+        records.push_back({document.id, document.status, document.ratings, document.text});
+    }
+    return records;
+}
+
+GeneratedCorpus GenerateZipfCorpus(const CorpusOptions& options) {
+    mt19937 generator(options.seed);
+    GeneratedCorpus corpus;
+
+    unordered_set<string> used_words;
+    corpus.vocabulary.reserve(options.vocabulary_size);
+    while (corpus.vocabulary.size() < options.vocabulary_size) {
+        string word = GenerateWord(generator, options.max_word_length);
+        if (used_words.insert(word).second) {
+            corpus.vocabulary.push_back(move(word));
+        }
+    }
+
+    const ZipfDistribution word_distribution(options.vocabulary_size, options.zipf_exponent);
+    // Параметр mu выбран так, чтобы среднее логнормального распределения равнялось mean_document_length
+    const double sigma = options.document_length_sigma;
+    lognormal_distribution<> length_distribution(log(options.mean_document_length) - sigma * sigma / 2, sigma);
+    discrete_distribution<int> status_distribution(options.status_weights.begin(), options.status_weights.end());
+    uniform_int_distribution<int> rating_count_distribution(0, options.max_rating_count);
+    uniform_int_distribution<int> rating_distribution(-10, 10);
+
+    corpus.documents.reserve(options.document_count);
+    for (size_t i = 0; i < options.document_count; ++i) {
+        GeneratedDocument document;
+        document.id = static_cast<int>(i);
+        document.status = static_cast<DocumentStatus>(status_distribution(generator));
+        document.ratings.resize(rating_count_distribution(generator));
+        for (int& rating : document.ratings) {
+            rating = rating_distribution(generator);
+        }
+        const size_t length = max<size_t>(1, static_cast<size_t>(llround(length_distribution(generator))));
+        for (size_t j = 0; j < length; ++j) {
+            if (j > 0) {
+                document.text.push_back(' ');
+            }
+            document.text += corpus.vocabulary[word_distribution(generator)];
+        }
+        corpus.documents.push_back(move(document));
+    }
+    return corpus;
+}
+
+vector<string> GenerateQueryLog(const vector<string>& vocabulary, const QueryLogOptions& options) {
+    if (options.min_query_length < 1 || options.min_query_length > options.max_query_length) {
+        throw invalid_argument("Invalid query length range"s);
+    }
+    mt19937 generator(options.seed);
+    const ZipfDistribution word_distribution(vocabulary.size(), options.word_zipf_exponent);
+    poisson_distribution<int> extra_length_distribution(max(options.mean_query_length - 1.0, 0.0));
+    bernoulli_distribution minus_distribution(options.minus_word_rate);
+
+    vector<string> distinct_queries(max<size_t>(options.distinct_query_count, 1));
+    for (string& query : distinct_queries) {
+        const int length = clamp(1 + extra_length_distribution(generator), options.min_query_length, options.max_query_length);
+        for (int i = 0; i < length; ++i) {
+            if (i > 0) {
+                query.push_back(' ');
+                if (minus_distribution(generator)) {
+                    query.push_back('-');
+                }
+            }
+            query += vocabulary[word_distribution(generator)];
+        }
+    }
+
+    const ZipfDistribution query_distribution(distinct_queries.size(), options.query_popularity_exponent);
+    vector<string> queries;
+    queries.reserve(options.query_count);
+    for (size_t i = 0; i < options.query_count; ++i) {
+        queries.push_back(distinct_queries[query_distribution(generator)]);
+    }
+    return queries;
+}
+
+void WriteCorpus(ostream& output, const GeneratedCorpus& corpus) {
+    for (const GeneratedDocument& document : corpus.documents) {
+        output << document.id << '\t' << document.status << '\t';
+        for (size_t i = 0; i < document.ratings.size(); ++i) {
+            output << (i > 0 ? " "s : ""s) << document.ratings[i];
+        }
+        output << '\t' << document.text << '\n';
+    }
+}
+
+void WriteQueryLog(ostream& output, const vector<string>& queries) {
+    for (const string& query : queries) {
+        output << query << '\n';
+    }
+}
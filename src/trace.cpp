@@ -0,0 +1,134 @@
+#include "../include/trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct TraceEvent {
+    const char* name = nullptr;
+    int64_t begin = 0;
+    int64_t end = 0;
+};
+
+const size_t THREAD_BUFFER_CAPACITY = 1 << 14;
+
+// Буфер принадлежит одному потоку: запись только из него, чтение — при выгрузке
+struct ThreadTraceBuffer {
+    uint32_t thread_id = 0;
+    array<TraceEvent, THREAD_BUFFER_CAPACITY> events;
+    atomic<uint64_t> event_count{0};
+};
+
+struct TraceRegistry {
+    atomic<bool> enabled{false};
+    const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+    mutex buffers_mutex;
+    // Буферы переживают свои потоки, чтобы события завершившихся потоков попали в выгрузку
+    vector<shared_ptr<ThreadTraceBuffer>> buffers;
+};
+
+TraceRegistry& GetRegistry() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+ThreadTraceBuffer& GetThreadBuffer() {
+    thread_local const shared_ptr<ThreadTraceBuffer> buffer = [] {
+        auto new_buffer = make_shared<ThreadTraceBuffer>();
+        TraceRegistry& registry = GetRegistry();
+        lock_guard guard(registry.buffers_mutex);
+        new_buffer->thread_id = static_cast<uint32_t>(registry.buffers.size() + 1);
+        registry.buffers.push_back(new_buffer);
+        return new_buffer;
+    }();
+    return *buffer;
+}
+
+void WriteJsonString(ostream& output, const char* text) {
+    output << '"';
+    for (const char* c = text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            output << '\\';
+        }
+        output << *c;
+    }
+    output << '"';
+}
+
+} // namespace
+
+void EnableTracing() {
+    GetRegistry().enabled.store(true, memory_order_relaxed);
+}
+
+void DisableTracing() {
+    GetRegistry().enabled.store(false, memory_order_relaxed);
+}
+
+bool IsTracingEnabled() {
+    return GetRegistry().enabled.load(memory_order_relaxed);
+}
+
+void RecordTraceEvent(const char* name, chrono::steady_clock::time_point begin, chrono::steady_clock::time_point end) {
+    const auto epoch = GetRegistry().epoch;
+    ThreadTraceBuffer& buffer = GetThreadBuffer();
+    const uint64_t index = buffer.event_count.load(memory_order_relaxed);
+    buffer.events[index % THREAD_BUFFER_CAPACITY] = TraceEvent{
+        name,
+        chrono::duration_cast<chrono::nanoseconds>(begin - epoch).count(),
+        chrono::duration_cast<chrono::nanoseconds>(end - epoch).count()};
+    buffer.event_count.store(index + 1, memory_order_release);
+}
+
+void WriteChromeTrace(ostream& output) {
+    TraceRegistry& registry = GetRegistry();
+    lock_guard guard(registry.buffers_mutex);
+    const auto flags = output.flags();
+    const auto precision = output.precision();
+    output << "{\"traceEvents\":["s << fixed << setprecision(3);
+    bool is_first = true;
+    for (const auto& buffer : registry.buffers) {
+        const uint64_t event_count = buffer->event_count.load(memory_order_acquire);
+        const uint64_t first = event_count - min<uint64_t>(event_count, THREAD_BUFFER_CAPACITY);
+        for (uint64_t i = first; i < event_count; ++i) {
+            const TraceEvent& event = buffer->events[i % THREAD_BUFFER_CAPACITY];
+            // Событие "X" содержит и начало, и длительность интервала; время — в микросекундах
+            output << (is_first ? ""s : ","s) << "\n{\"name\":"s;
+            WriteJsonString(output, event.name);
+            output << ",\"ph\":\"X\",\"pid\":1,\"tid\":"s << buffer->thread_id
+                   << ",\"ts\":"s << event.begin / 1000.0
+                   << ",\"dur\":"s << (event.end - event.begin) / 1000.0 << '}';
+            is_first = false;
+        }
+    }
+    output << "\n],\"displayTimeUnit\":\"ns\"}\n"s;
+    output.flags(flags);
+    output.precision(precision);
+}
+
+void ClearTrace() {
+    TraceRegistry& registry = GetRegistry();
+    lock_guard guard(registry.buffers_mutex);
+    for (const auto& buffer : registry.buffers) {
+        buffer->event_count.store(0, memory_order_relaxed);
+    }
+}
+
+size_t GetTraceEventCount() {
+    TraceRegistry& registry = GetRegistry();
+    lock_guard guard(registry.buffers_mutex);
+    size_t result = 0;
+    for (const auto& buffer : registry.buffers) {
+        result += static_cast<size_t>(min<uint64_t>(buffer->event_count.load(memory_order_acquire), THREAD_BUFFER_CAPACITY));
+    }
+    return result;
+}
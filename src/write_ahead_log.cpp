@@ -0,0 +1,230 @@
+#include "../include/write_ahead_log.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#define fsync _commit
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+template <typename T>
+void PutValue(string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool GetValue(string_view& in, T& value) {
+    if (in.size() < sizeof(value)) {
+        return false;
+    }
+    memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return true;
+}
+
+uint32_t ComputeChecksum(string_view data) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void WriteAll(int fd, string_view data) {
+    while (!data.empty()) {
+        const auto written = ::write(fd, data.data(), static_cast<unsigned>(data.size()));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error(errno, generic_category(), "WAL write failed"s);
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+string ReadFile(const string& path) {
+    ifstream input(path, ios::binary);
+    return {istreambuf_iterator<char>(input), istreambuf_iterator<char>()};
+}
+
+// Отделяет от начала data очередную запись с корректной контрольной суммой
+bool GetRecord(string_view& data, string_view& payload) {
+    string_view rest = data;
+    uint32_t size = 0;
+    uint32_t checksum = 0;
+    if (!GetValue(rest, size) || !GetValue(rest, checksum) || rest.size() < size) {
+        return false;
+    }
+    payload = rest.substr(0, size);
+    if (ComputeChecksum(payload) != checksum) {
+        return false;
+    }
+    data = rest.substr(size);
+    return true;
+}
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(SearchServer& search_server, const string& path, size_t batch_size)
+    : search_server_(search_server)
+    , fd_(-1)
+    , batch_size_(max<size_t>(batch_size, 1)) {
+    // Обрезаем оборванную запись в конце, иначе новые записи окажутся недостижимы при воспроизведении
+    const string data = ReadFile(path);
+    string_view rest = data;
+    string_view payload;
+    while (GetRecord(rest, payload)) {
+    }
+    if (!rest.empty()) {
+        filesystem::resize_file(path, data.size() - rest.size());
+    }
+
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+        throw system_error(errno, generic_category(), "Can't open WAL "s + path);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    try {
+        Sync();
+    } catch (...) {
+    }
+    ::close(fd_);
+}
+
+void WriteAheadLog::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    search_server_.AddDocument(document_id, document, status, ratings);
+
+    string payload;
+    payload.reserve(sizeof(uint8_t) * 2 + sizeof(int32_t) * (ratings.size() + 1) + sizeof(uint32_t) * 2 + document.size());
+    PutValue(payload, static_cast<uint8_t>(RecordType::ADD_DOCUMENT));
+    PutValue(payload, static_cast<int32_t>(document_id));
+    PutValue(payload, static_cast<uint8_t>(status));
+    PutValue(payload, static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        PutValue(payload, static_cast<int32_t>(rating));
+    }
+    PutValue(payload, static_cast<uint32_t>(document.size()));
+    payload.append(document);
+    AppendRecord(payload);
+}
+
+void WriteAheadLog::RemoveDocument(int document_id) {
+    search_server_.RemoveDocument(document_id);
+
+    string payload;
+    PutValue(payload, static_cast<uint8_t>(RecordType::REMOVE_DOCUMENT));
+    PutValue(payload, static_cast<int32_t>(document_id));
+    AppendRecord(payload);
+}
+
+void WriteAheadLog::AppendRecord(const string& payload) {
+    PutValue(buffer_, static_cast<uint32_t>(payload.size()));
+    PutValue(buffer_, ComputeChecksum(payload));
+    buffer_ += payload;
+    if (++pending_count_ >= batch_size_) {
+        Sync();
+    }
+}
+
+void WriteAheadLog::Sync() {
+    if (buffer_.empty()) {
+        return;
+    }
+    WriteAll(fd_, buffer_);
+    if (::fsync(fd_) != 0) {
+        throw system_error(errno, generic_category(), "WAL fsync failed"s);
+    }
+    buffer_.clear();
+    pending_count_ = 0;
+}
+
+size_t WriteAheadLog::GetPendingCount() const {
+    return pending_count_;
+}
+
+size_t WriteAheadLog::Replay(const string& path, SearchServer& search_server) {
+    // Журнал читается целиком, тексты документов передаются в AddDocuments без копирования
+    const string data = ReadFile(path);
+    string_view rest = data;
+    string_view payload;
+
+    vector<DocumentRecord> added;
+    vector<char> is_cancelled;
+    map<int, size_t> added_index;
+    vector<int> removed;
+    size_t record_count = 0;
+
+    while (GetRecord(rest, payload)) {
+        uint8_t type = 0;
+        int32_t document_id = 0;
+        if (!GetValue(payload, type) || !GetValue(payload, document_id)) {
+            break;
+        }
+        if (type == static_cast<uint8_t>(RecordType::REMOVE_DOCUMENT)) {
+            // Удаление отменяет добавление из этого же журнала, иначе относится к снимку
+            if (const auto it = added_index.find(document_id); it != added_index.end()) {
+                is_cancelled[it->second] = 1;
+                added_index.erase(it);
+            } else {
+                removed.push_back(document_id);
+            }
+        } else {
+            DocumentRecord record;
+            record.id = document_id;
+            uint8_t status = 0;
+            uint32_t rating_count = 0;
+            // Число рейтингов проверяется до выделения памяти под них
+            if (!GetValue(payload, status) || !GetValue(payload, rating_count)
+                || payload.size() / sizeof(int32_t) < rating_count) {
+                break;
+            }
+            record.status = static_cast<DocumentStatus>(status);
+            record.ratings.reserve(rating_count);
+            int32_t rating = 0;
+            while (record.ratings.size() < rating_count && GetValue(payload, rating)) {
+                record.ratings.push_back(rating);
+            }
+            uint32_t text_size = 0;
+            if (record.ratings.size() < rating_count || !GetValue(payload, text_size) || payload.size() < text_size) {
+                break;
+            }
+            record.text = payload.substr(0, text_size);
+            added_index[document_id] = added.size();
+            added.push_back(move(record));
+            is_cancelled.push_back(0);
+        }
+        ++record_count;
+    }
+
+    for (const int document_id : removed) {
+        search_server.RemoveDocument(document_id);
+    }
+    vector<DocumentRecord> batch;
+    batch.reserve(added.size());
+    for (size_t i = 0; i < added.size(); ++i) {
+        if (!is_cancelled[i]) {
+            batch.push_back(move(added[i]));
+        }
+    }
+    search_server.AddDocuments(execution::par, batch);
+    return record_count;
+}